@@ -2,6 +2,7 @@
 
 #include <cstring> // std::memcpy
 #include <type_traits> // std::enable_if
+#include <limits>
 #include "compiler_detect.hpp"
 #include "macros.hpp"
 
@@ -53,6 +54,39 @@ constexpr auto launder(T* p) noexcept -> T* {
 }
 
 
+/**
+ * @brief true if x is a (non-zero) power of two
+ */
+template <typename T>
+constexpr bool is_pow2 (T x) noexcept {
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+
+/**
+ * @brief the smallest power of two >= x (1 for x == 0), 0 if T has no such power of two (x > the top one)
+ */
+template <typename T>
+CORE_CPP14_CONSTEXPR_FUNC auto ceil_pow2 (T x) noexcept -> T {
+    constexpr T top = T(T(1) << (std::numeric_limits<T>::digits - 1)); // below the sign bit for a signed T
+    if (x > top) return 0;
+    T p = 1;
+    while (p < x) p <<= 1;
+    return p;
+}
+
+
+/**
+ * @brief floor(log2(x)) for x > 0, i.e. the shift for a power-of-two x
+ */
+template <typename T>
+CORE_CPP14_CONSTEXPR_FUNC auto log2 (T x) noexcept -> unsigned {
+    unsigned n = 0;
+    while (x >>= 1) ++n;
+    return n;
+}
+
+
 template <class As, class From> 
 auto alias (From & mem) -> As& {
     return *core::launder(reinterpret_cast<As*>(&mem));
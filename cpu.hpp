@@ -2,6 +2,8 @@
 
 #if __APPLE__
 #include "device_info/apple_platform.hpp"
+#elif __linux__
+#include "device_info/linux_platform.hpp"
 #elif defined __has_include && __has_include(<sys/param.h>) && __has_include(<sys/sysctl.h>)
 #include "device_info/sysctl_info.hpp"
 // #elif __WIN32__
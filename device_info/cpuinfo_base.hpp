@@ -1,5 +1,6 @@
 #pragma once
 #include <thread>
+#include <vector>
 #if __cpp_lib_hardware_interference_size && __cplusplus >= __cpp_lib_hardware_interference_size
     #include <new> // hardware_destructive_interference_size
 #endif
@@ -11,10 +12,17 @@ namespace device {
 
 using namespace integral;
 
+// GCC warns on every use of hardware_destructive_interference_size (its value depends on -mtune),
+// we only use it as a padding size, not as a part of an ABI
+#if defined __GNUC__ && !defined __clang__ && __GNUC__ >= 12
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Winterference-size"
+#endif
+
 struct CPUInfo {
     static constexpr i64 cacheline_size =  
     #if __cpp_lib_hardware_interference_size && __cplusplus >= __cpp_lib_hardware_interference_size
-        std::hardware_destructive_interference_size();
+        std::hardware_destructive_interference_size;
     #elif (__x86_64__ || __amd64__)    
         64; 
     #elif __powerpc__
@@ -32,6 +40,8 @@ struct CPUInfo {
     static bool has_hybrid_cores() { return false; }
     static i32 p_cores() { return 0; }
     static i32 e_cores() { return 0; }
+    static std::vector<unsigned> p_cpus() { return {}; } // logical cpu ids of the p-cores / e-cores, where the OS numbers them
+    static std::vector<unsigned> e_cpus() { return {}; }
 
     // static device::endian endianness() { 
     //     // manually check byte order
@@ -48,5 +58,9 @@ struct CPUInfo {
     // ....
 };
 
+#if defined __GNUC__ && !defined __clang__ && __GNUC__ >= 12
+    #pragma GCC diagnostic pop
+#endif
+
 }// namespace device
 }// namespace core
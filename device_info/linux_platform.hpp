@@ -0,0 +1,137 @@
+// Linux: CPU info from sysfs. Hybrid parts are recognised by (first match wins)
+//  - Intel (Alder Lake and later): the cpu_core / cpu_atom PMUs list their cpus in /sys/devices/cpu_core/cpus, /sys/devices/cpu_atom/cpus;
+//  - kernels exposing /sys/devices/system/cpu/types/<type>/cpulist ("*atom*" types are the E-cores);
+//  - ARM big.LITTLE / DynamIQ: the per-cpu /sys/devices/system/cpu/cpuN/cpu_capacity, the lowest-capacity cpus are the E-cores.
+// The topology is read once and cached. Without any of these (or with a single core type) the machine isn't hybrid:
+// p_cpus() / e_cpus() are empty and p_cores() / e_cores() are 0, as on the unknown platforms.
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include "../ints.hpp"
+#include "../endianness.hpp"
+#include "cpuinfo_base.hpp"
+
+namespace core {
+namespace device {
+
+using namespace integral;
+
+namespace sysfs {
+
+    inline bool read(std::string const& path, std::string & line) {
+        std::ifstream in {path};
+        return in && std::getline(in, line) && !line.empty();
+    }
+
+    // "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}, empty if malformed
+    inline std::vector<unsigned> parse_cpu_list(std::string const& list) {
+        std::vector<unsigned> cpus;
+        size_t pos = 0;
+        while ( pos < list.size() ) {
+            auto end = std::min(list.find(',', pos), list.size());
+            auto item = list.substr(pos, end - pos);
+            auto dash = item.find('-');
+            try {
+                if ( dash == std::string::npos ) cpus.push_back(unsigned(std::stoul(item)));
+                else for (auto cpu = std::stoul(item.substr(0, dash)), last = std::stoul(item.substr(dash + 1)); cpu <= last; ++cpu) cpus.push_back(unsigned(cpu));
+            }
+            catch (std::exception const&) { return {}; }
+            pos = end + 1;
+        }
+        return cpus;
+    }
+
+    inline std::vector<unsigned> read_cpu_list(std::string const& path) {
+        std::string list;
+        return read(path, list) ? parse_cpu_list(list) : std::vector<unsigned>{};
+    }
+
+    // logical cpu ids by core class, both empty on a non-hybrid machine
+    struct core_types {
+        std::vector<unsigned> performance;
+        std::vector<unsigned> efficiency;
+
+        bool hybrid() const { return !performance.empty() && !efficiency.empty(); }
+    };
+
+    /**
+     * @param root where sysfs is mounted (or a copy of the relevant part of it)
+     */
+    inline core_types read_core_types(std::string const& root = "/sys") {
+        core_types types;
+        auto done = [&] {
+            if ( types.hybrid() ) return true;
+            types = {};
+            return false;
+        };
+
+        // Intel hybrid PMUs
+        types.performance = read_cpu_list(root + "/devices/cpu_core/cpus");
+        types.efficiency = read_cpu_list(root + "/devices/cpu_atom/cpus");
+        if ( done() ) return types;
+
+        // cpu types directory
+        std::error_code ec;
+        for (auto & entry : std::filesystem::directory_iterator(root + "/devices/system/cpu/types", ec)) {
+            auto cpus = read_cpu_list(entry.path().string() + "/cpulist");
+            auto & cls = entry.path().filename().string().find("atom") != std::string::npos ? types.efficiency : types.performance;
+            cls.insert(cls.end(), cpus.begin(), cpus.end());
+        }
+        if ( done() ) return types;
+
+        // asymmetric cpu capacities
+        std::vector<std::pair<unsigned, unsigned>> capacities; // capacity, cpu
+        for (auto cpu : read_cpu_list(root + "/devices/system/cpu/online")) {
+            std::string capacity;
+            if ( !read(root + "/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpu_capacity", capacity) ) return {};
+            try { capacities.push_back({unsigned(std::stoul(capacity)), cpu}); }
+            catch (std::exception const&) { return {}; }
+        }
+        if ( capacities.empty() ) return {};
+        const auto lowest = std::min_element(capacities.begin(), capacities.end())->first;
+        for (auto [capacity, cpu] : capacities) (capacity == lowest ? types.efficiency : types.performance).push_back(cpu);
+        std::sort(types.performance.begin(), types.performance.end());
+        std::sort(types.efficiency.begin(), types.efficiency.end());
+        done();
+        return types;
+    }
+
+    inline core_types const& cached_core_types() {
+        static const core_types types = read_core_types();
+        return types;
+    }
+
+    // distinct physical cores among the cpus (SMT siblings count once)
+    inline i32 physical_cores(std::vector<unsigned> const& cpus, std::string const& root = "/sys") {
+        std::set<std::string> cores;
+        for (auto cpu : cpus) {
+            const auto topology = root + "/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            std::string siblings;
+            if ( !read(topology + "core_cpus_list", siblings) && !read(topology + "thread_siblings_list", siblings) ) siblings = std::to_string(cpu);
+            cores.insert(siblings);
+        }
+        return i32(cores.size());
+    }
+
+}// namespace sysfs
+
+
+struct CPU : CPUInfo {
+    static i32 n_cores() { return i32(sysfs::read_cpu_list("/sys/devices/system/cpu/online").size()); }
+    static i32 n_core_types() { return has_hybrid_cores() ? 2 : 1; }
+    static bool has_hybrid_cores() { return sysfs::cached_core_types().hybrid(); }
+    static i32 p_cores() { return sysfs::physical_cores(p_cpus()); }
+    static i32 e_cores() { return sysfs::physical_cores(e_cpus()); }
+    static std::vector<unsigned> p_cpus() { return sysfs::cached_core_types().performance; }
+    static std::vector<unsigned> e_cpus() { return sysfs::cached_core_types().efficiency; }
+};
+
+
+}// namespace device
+}// namespace core
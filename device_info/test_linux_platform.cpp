@@ -0,0 +1,110 @@
+//! Linux sysfs parsing: cpu lists and the hybrid core types, over fake sysfs trees in a temp directory
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+
+#include "linux_platform.hpp"
+
+namespace fs = std::filesystem;
+using namespace core::device;
+using cpus = std::vector<unsigned>;
+
+
+// a fresh directory standing in for /sys, removed when done
+struct fake_sysfs {
+    fake_sysfs(std::string const& name) : root{fs::temp_directory_path() / ("core_sysfs_" + name)} {
+        fs::remove_all(root);
+        fs::create_directories(root);
+    }
+    ~fake_sysfs() { fs::remove_all(root); }
+
+    void write(std::string const& path, std::string const& line) const {
+        auto file = root / path;
+        fs::create_directories(file.parent_path());
+        std::ofstream{file} << line << "\n";
+    }
+
+    std::string path() const { return root.string(); }
+
+    fs::path root;
+};
+
+
+void cpu_lists() {
+    assert(sysfs::parse_cpu_list("0") == cpus({0}));
+    assert(sysfs::parse_cpu_list("0-3") == cpus({0, 1, 2, 3}));
+    assert(sysfs::parse_cpu_list("0-3,8,10-11") == cpus({0, 1, 2, 3, 8, 10, 11}));
+    assert(sysfs::parse_cpu_list("").empty());
+    assert(sysfs::parse_cpu_list("x").empty());
+    assert(sysfs::parse_cpu_list("0-3,y").empty());
+
+    fake_sysfs sys {"lists"};
+    sys.write("devices/system/cpu/online", "0-5,7");
+    assert(sysfs::read_cpu_list(sys.path() + "/devices/system/cpu/online") == cpus({0, 1, 2, 3, 4, 5, 7}));
+    assert(sysfs::read_cpu_list(sys.path() + "/devices/system/cpu/missing").empty());
+    std::cout << "cpu lists: OK\n";
+}
+
+
+void core_types() {
+    {// Intel hybrid PMUs
+        fake_sysfs sys {"intel"};
+        sys.write("devices/cpu_core/cpus", "0-7");
+        sys.write("devices/cpu_atom/cpus", "8-15");
+        auto types = sysfs::read_core_types(sys.path());
+        assert(types.hybrid());
+        assert(types.performance == cpus({0, 1, 2, 3, 4, 5, 6, 7}));
+        assert(types.efficiency == cpus({8, 9, 10, 11, 12, 13, 14, 15}));
+    }
+    {// cpu types directory
+        fake_sysfs sys {"types"};
+        sys.write("devices/system/cpu/types/intel_core_1/cpulist", "0-3");
+        sys.write("devices/system/cpu/types/intel_atom_1/cpulist", "4-5");
+        auto types = sysfs::read_core_types(sys.path());
+        assert(types.performance == cpus({0, 1, 2, 3}));
+        assert(types.efficiency == cpus({4, 5}));
+    }
+    {// ARM asymmetric capacities: the lowest ones are the e-cores
+        fake_sysfs sys {"capacity"};
+        sys.write("devices/system/cpu/online", "0-3");
+        for (unsigned cpu : {0u, 1u}) sys.write("devices/system/cpu/cpu" + std::to_string(cpu) + "/cpu_capacity", "446");
+        for (unsigned cpu : {2u, 3u}) sys.write("devices/system/cpu/cpu" + std::to_string(cpu) + "/cpu_capacity", "1024");
+        auto types = sysfs::read_core_types(sys.path());
+        assert(types.performance == cpus({2, 3}));
+        assert(types.efficiency == cpus({0, 1}));
+    }
+    {// non-hybrid: equal capacities, a single PMU, or nothing at all
+        fake_sysfs sys {"flat"};
+        sys.write("devices/cpu_core/cpus", "0-3");
+        sys.write("devices/system/cpu/online", "0-1");
+        sys.write("devices/system/cpu/cpu0/cpu_capacity", "1024");
+        sys.write("devices/system/cpu/cpu1/cpu_capacity", "1024");
+        auto types = sysfs::read_core_types(sys.path());
+        assert(!types.hybrid() && types.performance.empty() && types.efficiency.empty());
+
+        fake_sysfs empty {"empty"};
+        assert(!sysfs::read_core_types(empty.path()).hybrid());
+    }
+    std::cout << "core types: OK\n";
+}
+
+
+void physical_cores() {
+    fake_sysfs sys {"smt"};
+    for (unsigned cpu : {0u, 1u}) sys.write("devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/core_cpus_list", "0-1");
+    for (unsigned cpu : {2u, 3u}) sys.write("devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list", "2-3");
+    assert(sysfs::physical_cores({0, 1, 2, 3}, sys.path()) == 2);
+    assert(sysfs::physical_cores({0, 1, 2, 3, 4}, sys.path()) == 3); // no topology: a core of its own
+    std::cout << "physical cores: OK\n";
+}
+
+
+int main() {
+    cpu_lists();
+    core_types();
+    physical_cores();
+}
@@ -0,0 +1,236 @@
+// core::parallel_for: runs a loop over a core::range (Range / StrideRange) on a core::thread_pool.
+// The iterations are split into chunks, handed to up to pool.size() lanes (the calling thread is one of them):
+//  - static:  chunks of `grain` iterations dealt round-robin to the lanes up front (grain 0: one contiguous block per lane),
+//             no shared state at all, best for uniform iterations;
+//  - dynamic: lanes grab the next `grain` iterations from a shared cursor (fetch_add) until it runs out, for uneven iterations;
+//  - guided:  like dynamic, but a grab takes a share of what's left (remaining / 2 lanes, at least `grain`): big chunks first,
+//             small ones near the end to even out the finish.
+// With a reduction every lane accumulates into an accumulator of its own (body(i, acc)), combined in lane order at the end.
+// Called from a pool worker the loop nests: waiting for the lanes runs other tasks of the pool.
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <exception>
+#include <algorithm> // min, max
+#include <type_traits>
+#include <utility> // move, forward
+#include "range.hpp"
+#include "cpu.hpp" // cacheline_size
+#include "thread_pool.hpp"
+
+namespace core {
+
+/**
+ * @brief how parallel_for splits the iterations, see the top of the file
+ * @param grain iterations per chunk (the minimal chunk for guided), 0 picks one from the iteration & lane counts
+ */
+struct parallel_policy {
+    enum chunking_type { static_chunking, dynamic_chunking, guided_chunking };
+
+    chunking_type chunking = static_chunking;
+    size_t grain = 0;
+    thread_pool * pool = nullptr; // nullptr: the pool of the calling worker, or else default_thread_pool()
+
+    static parallel_policy static_chunks(size_t grain = 0) { return {static_chunking, grain}; }
+    static parallel_policy dynamic_chunks(size_t grain = 0) { return {dynamic_chunking, grain}; }
+    static parallel_policy guided_chunks(size_t min_grain = 0) { return {guided_chunking, min_grain}; }
+
+    parallel_policy& on(thread_pool & p) { pool = &p; return *this; }
+};
+
+
+/**
+ * @brief an associative `combine(T, T) -> T` with its identity, for parallel_for's per-lane accumulators
+ */
+template <typename T, class Combine>
+struct reduction {
+    T identity;
+    Combine combine;
+};
+
+template <typename T, class Combine>
+auto reduce(T identity, Combine combine) -> reduction<T, Combine> { return {std::move(identity), std::move(combine)}; }
+
+
+// the pool parallel_for uses by default: hardware_concurrency() workers, started on first use
+inline thread_pool & default_thread_pool() {
+    static thread_pool pool;
+    return pool;
+}
+
+
+namespace detail {
+
+    // a range as n iterations: at(k) is the k-th value
+    template <typename T>
+    struct iteration_space {
+        iteration_space(Range<T> const& r) : from{r.from}, step{1}, n{r.to > r.from ? size_t(r.to - r.from) : 0} {}
+
+        // counted the way StrideRangeIterator advances, with the stride and the span taken as signed:
+        // an unsigned range's reverse() has a stride of T(-1) (and `to` may have wrapped around below 0)
+        iteration_space(StrideRange<T> const& r) : from{r.from}, step{r.stride}, n{0} {
+            static_assert(std::is_integral<T>::value, "parallel_for over a StrideRange needs an integral range");
+            using S = std::make_signed_t<T>;
+            const S stride = S(r.stride), span = S(r.to - r.from);
+            if ( stride > 0 && span > 0 ) n = size_t(span - 1) / size_t(stride) + 1;
+            if ( stride < 0 && span < 0 ) n = size_t(-(span + 1)) / size_t(-stride) + 1;
+        }
+
+        T at(size_t k) const noexcept { return T(from + T(k) * step); }
+
+        template <typename Run>
+        void run(size_t first, size_t last, Run & run_one) const {
+            if ( step == 1 ) { for (T i = at(first), end = at(last); i != end; ++i) run_one(i); }
+            else for (size_t k = first; k != last; ++k) run_one(at(k));
+        }
+
+        T from;
+        T step;
+        size_t n;
+    };
+
+    // hands out [first, last) chunks of [0, n) to the lanes
+    class chunk_scheduler {
+    public:
+        chunk_scheduler(parallel_policy const& policy, size_t n, size_t lanes)
+        : chunking{policy.chunking}, n{n}, lanes{lanes} {
+            grain = policy.grain;
+            if ( grain == 0 ) grain = chunking == parallel_policy::static_chunking ? (n + lanes - 1) / lanes // a block per lane
+                                    : chunking == parallel_policy::dynamic_chunking ? n / (8 * lanes)         // ~8 grabs per lane
+                                    : 1;
+            grain = std::max<size_t>(grain, 1);
+        }
+
+        // lane's next chunk; `state` is the lane's own (the next round for static chunking)
+        bool next(size_t lane, size_t & state, size_t & first, size_t & last) {
+            if ( stopped.load(std::memory_order_relaxed) ) return false;
+            first = n;
+            switch ( chunking ) {
+            case parallel_policy::static_chunking:
+                first = (state * lanes + lane) * grain;
+                ++state;
+                break;
+            case parallel_policy::dynamic_chunking:
+                first = cursor.load(std::memory_order_relaxed) < n ? cursor.fetch_add(grain, std::memory_order_relaxed) : n;
+                break;
+            case parallel_policy::guided_chunking: {
+                first = cursor.load(std::memory_order_relaxed);
+                size_t size;
+                do {
+                    if ( first >= n ) return false;
+                    size = std::max(grain, (n - first) / (2 * lanes));
+                } while ( !cursor.compare_exchange_weak(first, first + size, std::memory_order_relaxed) );
+                last = std::min(first + size, n);
+                return true;
+            }
+            }
+            if ( first >= n ) return false;
+            last = std::min(first + grain, n);
+            return true;
+        }
+
+        // an iteration threw: the lanes take no more chunks
+        void stop() noexcept { stopped.store(true, std::memory_order_relaxed); }
+
+        size_t chunk_size() const noexcept { return grain; }
+
+    private:
+        const parallel_policy::chunking_type chunking;
+        const size_t n;
+        const size_t lanes;
+        size_t grain;
+        std::atomic<bool> stopped {false};
+        alignas(core::device::CPU::cacheline_size)
+        std::atomic<size_t> cursor {0};
+    };
+
+    template <typename T>
+    struct alignas(core::device::CPU::cacheline_size) lane_accumulator {
+        T value;
+    };
+
+    // runs `lane(l)` for l in [0, lanes): 0 on the calling thread, the rest on the pool; rethrows the first exception
+    template <typename Lane>
+    void run_lanes(thread_pool & pool, size_t lanes, Lane & lane) {
+        std::vector<task_future<void>> others;
+        others.reserve(lanes - 1);
+        std::exception_ptr error;
+        try {
+            for (size_t l = 1; l < lanes; ++l) others.push_back(pool.submit([&lane, l]{ lane(l); }));
+            lane(0);
+        }
+        catch (...) { error = std::current_exception(); }
+        for (auto & f : others) { // all of them, they refer to the caller's stack
+            try { f.get(); }
+            catch (...) { if ( !error ) error = std::current_exception(); }
+        }
+        if ( error ) std::rethrow_exception(error);
+    }
+
+    inline thread_pool & pool_for(parallel_policy const& policy) {
+        if ( policy.pool ) return *policy.pool;
+        if ( auto * current = thread_pool::current() ) return *current;
+        return default_thread_pool();
+    }
+
+}// namespace detail
+
+
+/**
+ * @brief body(i) for every i in the range, in parallel
+ * @remark an exception thrown by the body stops the loop early (the lanes take no more chunks) and is rethrown
+ */
+template <class R, class Body>
+void parallel_for(R const& range, Body && body, parallel_policy const& policy = {}) {
+    const detail::iteration_space<std::decay_t<decltype(range.from)>> space {range};
+    if ( space.n == 0 ) return;
+    auto & pool = detail::pool_for(policy);
+    const auto lanes = std::min(pool.size(), space.n);
+
+    detail::chunk_scheduler chunks {policy, space.n, lanes};
+    if ( lanes == 1 || chunks.chunk_size() >= space.n ) return space.run(0, space.n, body);
+
+    auto lane = [&](size_t l) {
+        size_t state = 0, first, last;
+        try { while ( chunks.next(l, state, first, last) ) space.run(first, last, body); }
+        catch (...) { chunks.stop(); throw; }
+    };
+    detail::run_lanes(pool, lanes, lane);
+}
+
+/**
+ * @brief body(i, acc) for every i in the range, in parallel, with an accumulator per lane (starting at the identity)
+ * @return the lanes' accumulators combined
+ */
+template <class R, class Body, typename T, class Combine>
+T parallel_for(R const& range, Body && body, parallel_policy const& policy, reduction<T, Combine> const& red) {
+    const detail::iteration_space<std::decay_t<decltype(range.from)>> space {range};
+    if ( space.n == 0 ) return red.identity;
+    auto & pool = detail::pool_for(policy);
+    const auto lanes = std::min(pool.size(), space.n);
+
+    detail::chunk_scheduler chunks {policy, space.n, lanes};
+    if ( lanes == 1 || chunks.chunk_size() >= space.n ) {
+        T acc = red.identity;
+        auto run_one = [&](auto i) { body(i, acc); };
+        space.run(0, space.n, run_one);
+        return acc;
+    }
+
+    std::vector<detail::lane_accumulator<T>> accumulators (lanes, {red.identity});
+    auto lane = [&](size_t l) {
+        auto & acc = accumulators[l].value;
+        auto run_one = [&](auto i) { body(i, acc); };
+        size_t state = 0, first, last;
+        try { while ( chunks.next(l, state, first, last) ) space.run(first, last, run_one); }
+        catch (...) { chunks.stop(); throw; }
+    };
+    detail::run_lanes(pool, lanes, lane);
+
+    T result = red.identity;
+    for (auto & a : accumulators) result = red.combine(std::move(result), std::move(a.value));
+    return result;
+}
+
+}// namespace core
@@ -103,8 +103,8 @@ public:
 
     constexpr StrideRange(T begin, T end, T step) noexcept 
     : from{ begin }
-    , to{ end }
-    , stride{ step } 
+    , stride{ step }
+    , to{ end } 
     {}
     
     constexpr auto begin() const noexcept -> StrideRangeIterator<T> {
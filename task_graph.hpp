@@ -0,0 +1,287 @@
+// core::task_graph: a DAG of callables run on a core::thread_pool.
+// Every node keeps an atomic count of its unfinished predecessors: a finishing node decrements its successors' counts,
+// the one that brings a count to zero schedules that successor (the first ready successor runs right away on the same worker,
+// the others go to the worker's deque where idle workers steal them), so independent branches overlap by themselves.
+// The graph is built once and can be run any number of times: a run resets the counters in place, nothing is allocated
+// unless the structure changed since the previous run (then it's checked for cycles again).
+// Every run records when and on which worker each node ran; an optional hook sees each node as it finishes.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <string>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+#include <utility> // move, forward
+#include "cpu.hpp" // cacheline_size
+#include "ints.hpp"
+#include "range.hpp"
+#include "thread_pool.hpp"
+#include "threadsafe/auxiliary/event_count.hpp" // park / unpark, backoff policies
+
+namespace core {
+
+/**
+ * @brief a DAG of tasks: build it with emplace() & precede(), run it on a pool with run()
+ * @remark the graph must outlive its runs and not be modified while running
+ */
+class task_graph {
+    struct node;
+
+public:
+    using clock = std::chrono::steady_clock;
+
+    // a node as seen by the timing hook, after it ran
+    struct node_timing {
+        size_t id;
+        std::string const& name;
+        size_t worker; // thread_pool::worker_index() of the worker that ran it
+        clock::time_point start;
+        clock::time_point finish;
+
+        clock::duration duration() const noexcept { return finish - start; }
+    };
+
+    using timing_hook = std::function<void(node_timing const&)>;
+
+    /**
+     * @brief a handle to a node of the graph, cheap to copy
+     */
+    class task {
+    public:
+        task() = default;
+
+        // this one runs before `others`
+        template <typename... Tasks>
+        task& precede(Tasks... others) { (link(*this, others), ...); return *this; }
+
+        // this one runs after `others`
+        template <typename... Tasks>
+        task& succeed(Tasks... others) { (link(others, *this), ...); return *this; }
+
+        size_t id() const noexcept { return n->id; }
+        std::string const& name() const noexcept { return n->name; }
+
+        // the node as it ran last time
+        node_timing timing() const noexcept { return {n->id, n->name, n->worker, n->start, n->finish}; }
+
+        bool valid() const noexcept { return n != nullptr; }
+
+    private:
+        friend class task_graph;
+        explicit task(node * n) noexcept : n{n} {}
+
+        static void link(task before, task after) {
+            if ( before.n->graph != after.n->graph ) throw std::invalid_argument("task_graph: an edge between two graphs");
+            before.n->successors.push_back(after.n);
+            ++after.n->n_predecessors;
+            before.n->graph->validated = false;
+        }
+
+        node * n {nullptr};
+    };
+
+    task_graph() = default;
+    task_graph(task_graph const&) = delete;
+    task_graph& operator= (task_graph const&) = delete;
+
+    /**
+     * @brief adds a node running f() (copied / moved into the graph), with no dependencies yet
+     */
+    template <typename F>
+    task emplace(F && f, std::string name = {}) {
+        using callable_type = callable_node<std::decay_t<F>>;
+        nodes.push_back(std::make_unique<callable_type>(std::forward<F>(f)));
+        auto & n = *nodes.back();
+        n.graph = this;
+        n.id = nodes.size() - 1;
+        n.name = std::move(name);
+        validated = false;
+        return task{&n};
+    }
+
+    // `before` runs before `after`
+    void precede(task before, task after) { before.precede(after); }
+
+    size_t size() const noexcept { return nodes.size(); }
+    bool empty() const noexcept { return nodes.empty(); }
+
+    task operator[] (size_t id) const noexcept { return task{nodes[id].get()}; }
+
+    /**
+     * @brief hook(timing) is called by the worker that ran a node, right after it (concurrently for parallel nodes:
+     *        it has to be threadsafe, and must not throw). An empty hook turns it off.
+     */
+    void on_node_finish(timing_hook hook) { finish_hook = std::move(hook); }
+
+    /**
+     * @brief runs the graph on the pool and waits for it: every node after all of its predecessors
+     * @remark a node that throws cancels the run: the nodes that haven't started yet are skipped, the first exception is rethrown.
+     *         Called from a worker of the pool, the calling worker runs tasks of the pool while it waits.
+     * @throws std::invalid_argument if the graph has a cycle, thread_pool::pool_closed if the pool is shut down
+     */
+    void run(thread_pool & pool) {
+        if ( nodes.empty() ) return;
+        if ( running.exchange(true, std::memory_order_acquire) ) throw std::logic_error("task_graph::run: the graph is already running");
+        struct run_guard {
+            std::atomic<bool> & running;
+            ~run_guard() { running.store(false, std::memory_order_release); }
+        } guard {running};
+
+        if ( !validated ) validate();
+
+        for (auto & n : nodes) n->pending.store(n->n_predecessors, std::memory_order_relaxed);
+        remaining.store(nodes.size(), std::memory_order_relaxed);
+        status.store(pending, std::memory_order_relaxed);
+        failed.store(false, std::memory_order_relaxed);
+        error = nullptr;
+        executor = &pool;
+
+        if ( thread_pool::current() == &pool ) launch_roots();
+        else pool.schedule([this]{ return &launcher; }); // one task from outside, the roots are pushed from inside the pool
+
+        wait();
+        if ( error ) std::rethrow_exception(error);
+    }
+
+private:
+    struct node : detail::pool_task {
+        node(void (*call)(node*)) : detail::pool_task{&task_graph::execute}, call{call} {}
+        virtual ~node() = default;
+
+        void (*call)(node*);
+
+        task_graph * graph {nullptr};
+        size_t id {0};
+        std::string name;
+        std::vector<node*> successors;
+        u32 n_predecessors {0};
+
+        std::atomic<u32> pending {0}; // predecessors still to finish in the current run
+
+        // the last run
+        size_t worker {thread_pool::npos};
+        clock::time_point start {};
+        clock::time_point finish {};
+    };
+
+    template <typename F>
+    struct callable_node : node {
+        template <typename G>
+        callable_node(G && g) : node{&invoke}, f{std::forward<G>(g)} {}
+
+        static void invoke(node * n) { static_cast<callable_node*>(n)->f(); }
+
+        F f;
+    };
+
+    // launcher: the task that pushes the roots, so that only one task enters the pool from outside
+    struct root_launcher : detail::pool_task {
+        root_launcher(task_graph * graph) : detail::pool_task{&run}, graph{graph} {}
+        static void run(detail::pool_task * t) noexcept { static_cast<root_launcher*>(t)->graph->launch_roots(); }
+        task_graph * graph;
+    };
+
+    enum status_type : u32 { pending, awaited, finished, released };
+
+    void launch_roots() noexcept {
+        for (auto * root : roots) executor->schedule([root]{ return root; });
+    }
+
+    // runs n, then whichever successor it made ready first, and so on; the other ready successors go to the deque
+    static void execute(detail::pool_task * t) noexcept {
+        auto * n = static_cast<node*>(t);
+        auto & graph = *n->graph;
+        while ( n ) {
+            graph.run_node(*n);
+
+            node * next = nullptr;
+            for (auto * s : n->successors) {
+                if ( s->pending.fetch_sub(1, std::memory_order_acq_rel) != 1 ) continue;
+                if ( !next ) next = s;
+                else graph.executor->schedule([s]{ return s; });
+            }
+            graph.node_done(); // last: once the final node is done, the graph may go away
+            n = next;
+        }
+    }
+
+    void run_node(node & n) noexcept {
+        n.worker = thread_pool::worker_index();
+        n.start = clock::now();
+        if ( !failed.load(std::memory_order_relaxed) ) {
+            try { n.call(&n); }
+            catch (...) {
+                if ( !failed.exchange(true, std::memory_order_relaxed) ) error = std::current_exception();
+            }
+        }
+        n.finish = clock::now();
+        if ( finish_hook ) finish_hook(node_timing{n.id, n.name, n.worker, n.start, n.finish});
+    }
+
+    void node_done() noexcept {
+        if ( remaining.fetch_sub(1, std::memory_order_acq_rel) != 1 ) return;
+        if ( status.exchange(finished, std::memory_order_acq_rel) == awaited ) detail::unpark(status, true);
+        status.store(released, std::memory_order_release); // the waiter may return (and destroy the graph) from here on
+    }
+
+    void wait() {
+        if ( thread_pool::current() == executor ) { // help out instead of blocking the worker
+            core::default_backoff backoff;
+            while ( remaining.load(std::memory_order_acquire) != 0 ) {
+                if ( executor->run_one() ) { backoff.reset(); continue; }
+                if ( backoff() ) break;
+            }
+        }
+        auto s = status.load(std::memory_order_acquire);
+        while ( s != released ) {
+            if ( s == pending ) {
+                if ( status.compare_exchange_weak(s, awaited, std::memory_order_acquire) ) detail::park(status, awaited);
+            }
+            else if ( s == awaited ) detail::park(status, awaited);
+            else core::cpu_relax(); // finished: the last node is about to let go
+            s = status.load(std::memory_order_acquire);
+        }
+    }
+
+    // Kahn's algorithm: finds the roots and throws if some nodes are never reached (a cycle)
+    void validate() {
+        roots.clear();
+        std::vector<u32> in_degree (nodes.size());
+        std::vector<node*> ready;
+        for (auto & n : nodes) {
+            in_degree[n->id] = n->n_predecessors;
+            if ( n->n_predecessors == 0 ) { roots.push_back(n.get()); ready.push_back(n.get()); }
+        }
+        size_t reached = 0;
+        while ( !ready.empty() ) {
+            auto * n = ready.back();
+            ready.pop_back();
+            ++reached;
+            for (auto * s : n->successors) if ( --in_degree[s->id] == 0 ) ready.push_back(s);
+        }
+        if ( reached != nodes.size() ) throw std::invalid_argument("task_graph: the graph has a cycle");
+        validated = true;
+    }
+
+    std::vector<std::unique_ptr<node>> nodes;
+    std::vector<node*> roots;
+    bool validated {true};
+    timing_hook finish_hook;
+    root_launcher launcher {this};
+    thread_pool * executor {nullptr};
+
+    std::exception_ptr error;
+    std::atomic<bool> running {false};
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<bool> failed {false};
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<size_t> remaining {0}; // nodes still to finish in the current run
+    std::atomic<u32> status {pending};
+};
+
+}// namespace core
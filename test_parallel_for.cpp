@@ -0,0 +1,117 @@
+//! parallel_for: every iteration exactly once for each chunking / range kind, reductions, exceptions, nesting & timing
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <functional> // plus
+#include <type_traits>
+#include "range.hpp"
+#include "timing.hpp"
+
+#include "parallel_for.hpp"
+
+
+// each i of the range is visited once, nothing else is; the k-th value is first + k * step (wrapping around for unsigned T)
+template <class R>
+using value_of = std::decay_t<decltype(R::from)>;
+
+template <class R>
+void check_coverage(R const& range, size_t n, value_of<R> first, std::make_signed_t<value_of<R>> step, core::parallel_policy const& policy) {
+    using T = value_of<R>;
+    using S = std::make_signed_t<T>;
+    std::vector<std::atomic<int>> seen (n);
+    core::parallel_for(range, [&](T i) {
+        const auto distance = S(i - first);
+        assert(distance % step == 0);
+        auto k = size_t(distance / step);
+        assert(k < n);
+        seen[k].fetch_add(1, std::memory_order_relaxed);
+    }, policy);
+    for (auto & s : seen) assert(s == 1);
+
+    size_t sequential = 0;
+    for (T i : range) { (void)i; ++sequential; }
+    assert(sequential == n); // the same count as the plain loop over the range
+}
+
+
+int main() {
+    using core::timing::ms;
+    using policy = core::parallel_policy;
+
+    core::thread_pool pool {4};
+    const policy policies[] = {
+        policy::static_chunks().on(pool), policy::static_chunks(7).on(pool),
+        policy::dynamic_chunks().on(pool), policy::dynamic_chunks(1).on(pool),
+        policy::guided_chunks().on(pool), policy::guided_chunks(16).on(pool),
+    };
+
+    for (auto & p : policies) {
+        check_coverage(core::range(0L, 10'007L), 10'007, 0, 1, p);
+        check_coverage(core::range(-50L, 50L), 100, -50, 1, p);
+        check_coverage(core::range(3L, 1'000L, 7L), (1'000 - 3 + 6) / 7, 3, 7, p);
+        check_coverage(core::range(999L, -1L, -3L), (999 + 1 + 2) / 3, 999, -3, p);
+        check_coverage(core::range(5L, 5L), 0, 5, 1, p);
+        check_coverage(core::range(0L, 3L), 3, 0, 1, p);
+        check_coverage(core::range(0L, 1'000L).reverse(), 1'000, 999, -1, p);
+        // unsigned: reverse() has a stride of T(-1), `to` wraps around below 0
+        check_coverage(core::range(size_t(100)).reverse(), 100, 99, -1, p);
+        check_coverage(core::range(size_t(10'007)).reverse(), 10'007, 10'006, -1, p);
+        check_coverage(core::range(0u, 1'000u, 3u), (1'000 + 2) / 3, 0, 3, p);
+        check_coverage(core::range(size_t(17), size_t(10'000)), 10'000 - 17, 17, 1, p);
+        check_coverage(core::range(size_t(0)).reverse(), 0, size_t(-1), -1, p);
+    }
+    std::cout << "coverage (static / dynamic / guided, Range / StrideRange, signed / unsigned, reverse()): OK\n";
+
+    {// reductions
+        constexpr long N = 1'000'000;
+        for (auto & p : policies) {
+            auto sum = core::parallel_for(core::range(N), [](long i, long & acc){ acc += i; }, p, core::reduce(0L, std::plus<>{}));
+            assert(sum == N*(N-1)/2);
+        }
+        auto max = core::parallel_for(core::range(N), [](long i, long & acc){ acc = std::max(acc, (i * 7919) % N); },
+                                      policy::dynamic_chunks().on(pool), core::reduce(0L, [](long a, long b){ return std::max(a, b); }));
+        assert(max == N - 1);
+        std::cout << "reductions: OK\n";
+    }
+
+    {// an exception stops the loop and comes out of parallel_for
+        std::atomic<long> ran {0};
+        bool caught = false;
+        try {
+            core::parallel_for(core::range(1'000'000L), [&](long i) {
+                ran.fetch_add(1, std::memory_order_relaxed);
+                if ( i == 1000 ) throw std::runtime_error{"iteration failed"};
+            }, policy::dynamic_chunks(64).on(pool));
+        }
+        catch (std::runtime_error const&) { caught = true; }
+        assert(caught && ran < 1'000'000);
+        std::cout << "exceptions: OK (" << ran << " iterations ran)\n";
+    }
+
+    {// nested: an outer parallel_for on the pool, inner ones from its workers
+        auto total = core::parallel_for(core::range(64L), [&](long, long & acc) {
+            acc += core::parallel_for(core::range(1000L), [](long j, long & a){ a += j; }, policy::guided_chunks(), core::reduce(0L, std::plus<>{}));
+        }, policy::dynamic_chunks(1).on(pool), core::reduce(0L, std::plus<>{}));
+        assert(total == 64 * (1000L * 999 / 2));
+        std::cout << "nested: OK\n";
+    }
+
+    {// timing: a scoring-like loop, sequential vs. the default pool
+        constexpr size_t N = 4'000'000;
+        std::vector<double> x (N), y (N);
+        for (size_t i : core::range(N)) x[i] = double(i % 1000) / 1000.0;
+        auto score = [&](size_t i){ y[i] = std::exp(-x[i]) * std::sqrt(x[i] + 1.0); };
+
+        auto seq = core::timeit([&]{ for (size_t i : core::range(N)) score(i); });
+        std::cout << "sequential: " << seq.in<ms>() << "ms\n";
+        for (auto p : {policy::static_chunks(), policy::dynamic_chunks(), policy::guided_chunks()}) {
+            auto par = core::timeit([&]{ core::parallel_for(core::range(N), score, p); });
+            std::cout << "parallel [" << (p.chunking == policy::static_chunking ? "static" : p.chunking == policy::dynamic_chunking ? "dynamic" : "guided")
+                      << ", " << core::default_thread_pool().size() << " workers]: " << par.in<ms>() << "ms\n";
+        }
+    }
+}
@@ -0,0 +1,155 @@
+//! task_graph: dependency order, re-runs without allocations, exceptions, cycles, nesting, timing hooks & overlap of branches
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include "range.hpp"
+#include "timing.hpp"
+
+#include "task_graph.hpp"
+
+
+// counts every allocation, to check that re-running a built graph doesn't allocate
+// (GCC takes the malloc / free pair of the replaced operators for a mismatch)
+#if defined __GNUC__ && !defined __clang__ && __GNUC__ >= 11
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<size_t> allocations {0};
+
+void * operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if ( auto * p = std::malloc(size ? size : 1) ) return p;
+    throw std::bad_alloc{};
+}
+void operator delete(void * p) noexcept { std::free(p); }
+void operator delete(void * p, size_t) noexcept { ::operator delete(p); }
+
+
+// ~work_us microseconds of arithmetic
+double busy(int work_us) {
+    double x = 1.0;
+    for (int i = 0; i < work_us * 100; ++i) x = std::sqrt(x + double(i));
+    return x;
+}
+
+
+int main() {
+    using core::timing::ms;
+    core::thread_pool pool {4};
+
+    {// a layered DAG of 200 stages (the nightly job's shape): every node starts after all of its predecessors finished
+        constexpr size_t N = 200;
+        core::task_graph graph;
+        std::atomic<size_t> clock {0};
+        std::vector<size_t> started (N), finished (N);
+        std::vector<core::task_graph::task> tasks;
+        std::vector<std::pair<size_t, size_t>> edges;
+
+        for (size_t i : core::range(N)) {
+            tasks.push_back(graph.emplace([&, i]{
+                started[i] = clock.fetch_add(1);
+                finished[i] = clock.fetch_add(1);
+            }, "stage-" + std::to_string(i)));
+        }
+        std::uint64_t seed = 42;
+        for (size_t i : core::range(size_t(10), N)) { // up to 3 edges from earlier stages
+            for (int e = 0; e < 3; ++e) {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                auto from = size_t(seed >> 33) % i;
+                tasks[from].precede(tasks[i]);
+                edges.push_back({from, i});
+            }
+        }
+
+        for (int run = 0; run < 100; ++run) {
+            if ( run == 1 ) allocations = 0; // the first run checks the graph and warms the pool's queues up
+            graph.run(pool);
+            for (auto [from, to] : edges) assert(finished[from] < started[to]);
+            assert(clock == 2 * N * (run + 1));
+        }
+        assert(allocations == 0);
+        std::cout << "200-stage DAG, 100 runs: order OK, no allocations after the first run\n";
+    }
+
+    {// a throwing node cancels the rest of the run and comes out of run(); the graph stays usable
+        core::task_graph graph;
+        std::atomic<int> ran {0};
+        bool fail = true;
+        auto a = graph.emplace([&]{ ++ran; });
+        auto b = graph.emplace([&]{ ++ran; if ( fail ) throw std::runtime_error{"stage failed"}; });
+        auto c = graph.emplace([&]{ ++ran; });
+        a.precede(b);
+        b.precede(c);
+
+        bool caught = false;
+        try { graph.run(pool); } catch (std::runtime_error const&) { caught = true; }
+        assert(caught && ran == 2);
+
+        fail = false;
+        ran = 0;
+        graph.run(pool);
+        assert(ran == 3);
+        std::cout << "exceptions: OK\n";
+    }
+
+    {// cycles are refused before anything runs
+        core::task_graph graph;
+        std::atomic<int> ran {0};
+        auto a = graph.emplace([&]{ ++ran; });
+        auto b = graph.emplace([&]{ ++ran; });
+        auto c = graph.emplace([&]{ ++ran; });
+        a.precede(b);
+        b.precede(c);
+        c.precede(b);
+        bool refused = false;
+        try { graph.run(pool); } catch (std::invalid_argument const&) { refused = true; }
+        assert(refused && ran == 0);
+        std::cout << "cycles: OK\n";
+    }
+
+    {// a graph run from inside a pool task: the waiting worker runs the nodes itself
+        core::task_graph inner;
+        std::atomic<int> ran {0};
+        auto root = inner.emplace([&]{ ++ran; });
+        for (int i = 0; i < 16; ++i) root.precede(inner.emplace([&]{ ++ran; }));
+        pool.submit([&]{ for (int r = 0; r < 10; ++r) inner.run(pool); }).get();
+        assert(ran == 17 * 10);
+        std::cout << "nested: OK\n";
+    }
+
+    {// timing hook & recorded timings; overlap of independent branches
+        constexpr int branches = 4, depth = 8, work_us = 500;
+        core::task_graph graph;
+        auto source = graph.emplace([]{}, "source");
+        auto sink = graph.emplace([]{}, "sink");
+        for (int b = 0; b < branches; ++b) {
+            auto prev = source;
+            for (int d = 0; d < depth; ++d) {
+                auto t = graph.emplace([]{ volatile double x = busy(work_us); (void)x; }, "b" + std::to_string(b) + "." + std::to_string(d));
+                prev.precede(t);
+                prev = t;
+            }
+            prev.precede(sink);
+        }
+
+        std::atomic<size_t> hooked {0};
+        graph.on_node_finish([&](core::task_graph::node_timing const& t) {
+            assert(t.worker < pool.size() && t.finish >= t.start);
+            hooked.fetch_add(1, std::memory_order_relaxed);
+        });
+        graph.run(pool);
+        assert(hooked == graph.size());
+        assert(source.timing().finish <= graph[2].timing().start && graph[2].timing().duration().count() > 0);
+        graph.on_node_finish({});
+
+        auto seq = core::timeit([&]{ for (int i = 0; i < branches * depth; ++i) { volatile double x = busy(work_us); (void)x; } });
+        auto par = core::timeit([&]{ graph.run(pool); });
+        std::cout << "sequential: " << seq.in<ms>() << "ms, graph of " << branches << " branches on " << pool.size() << " workers: " << par.in<ms>() << "ms\n";
+    }
+}
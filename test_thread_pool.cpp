@@ -0,0 +1,117 @@
+//! Work-stealing thread pool: correctness checks & per-task overhead
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+#include "range.hpp"
+#include "timing.hpp"
+
+#include "thread_pool.hpp"
+
+
+// fork-join: every level waits for the tasks it submitted (the waiting worker runs other tasks meanwhile)
+long fib(core::thread_pool & pool, int n) {
+    if ( n < 12 ) {
+        long a = 0, b = 1;
+        for (int i = 0; i < n; ++i) { auto c = a + b; a = b; b = c; }
+        return a;
+    }
+    auto left = pool.submit(fib, std::ref(pool), n - 1);
+    auto right = fib(pool, n - 2);
+    return left.get() + right;
+}
+
+
+int main() {
+    using core::timing::ms;
+
+    {// results, arguments, exceptions
+        core::thread_pool pool {4};
+        auto sum = pool.submit([](int a, int b){ return a + b; }, 2, 3);
+        auto nothing = pool.submit([]{});
+        auto fails = pool.submit([]() -> int { throw std::runtime_error{"task failed"}; });
+        assert(sum.get() == 5 && !sum.valid());
+        nothing.get();
+        bool caught = false;
+        try { fails.get(); } catch (std::runtime_error const&) { caught = true; }
+        assert(caught);
+        std::cout << "submit / get / exceptions: OK\n";
+    }
+
+    {// fork-join from inside the pool
+        core::thread_pool pool {4};
+        auto result = pool.submit(fib, std::ref(pool), 30).get();
+        assert(result == 832040);
+        std::cout << "nested fib(30): OK\n";
+    }
+
+    {// graceful shutdown runs everything scheduled, including what the tasks schedule; no more submits afterwards
+        constexpr size_t N = 100'000;
+        std::atomic<size_t> ran {0};
+        core::thread_pool pool {4};
+        for (size_t i : core::range(N / 2)) {
+            (void)i;
+            pool.post([&]{
+                ran.fetch_add(1, std::memory_order_relaxed);
+                core::thread_pool::current()->post([&]{ ran.fetch_add(1, std::memory_order_relaxed); });
+            });
+        }
+        pool.shutdown();
+        assert(ran == N);
+        bool rejected = false;
+        try { pool.post([]{}); } catch (core::thread_pool::pool_closed const&) { rejected = true; }
+        assert(rejected);
+        std::cout << "shutdown drains " << ran << " tasks: OK\n";
+    }
+
+    {// a submit that throws while building its task leaves nothing behind: the pool keeps working and shuts down
+        struct poison { // copied into the task's arguments fine, moving it into the task throws
+            poison() = default;
+            poison(poison const&) = default;
+            poison(poison &&) { throw std::runtime_error{"poison moved"}; }
+        };
+        core::thread_pool pool {2};
+        poison p;
+        bool caught = false;
+        try { pool.post([](poison const&){}, p); } catch (std::runtime_error const&) { caught = true; }
+        assert(caught);
+        assert(pool.submit([]{ return 42; }).get() == 42);
+        pool.shutdown(); // used to wait for the failed submit forever
+        std::cout << "throwing submit: OK\n";
+    }
+
+    {// per-task overhead: N empty tasks
+        constexpr size_t N = 1'000'000;
+        core::thread_pool pool;
+        std::atomic<size_t> ran {0};
+
+        auto outside = core::timeit([&]{
+            for (size_t i : core::range(N)) { (void)i; pool.post([&]{ ran.fetch_add(1, std::memory_order_relaxed); }); }
+            while ( ran.load() != N ) std::this_thread::yield();
+        });
+        std::cout << "post from outside: " << outside.in<ms>() << "ms for " << N << " tasks\n";
+
+        ran = 0;
+        auto inside = core::timeit([&]{
+            pool.submit([&]{
+                for (size_t i : core::range(N)) { (void)i; pool.post([&]{ ran.fetch_add(1, std::memory_order_relaxed); }); }
+            }).get();
+            while ( ran.load() != N ) std::this_thread::yield();
+        });
+        std::cout << "post from a worker: " << inside.in<ms>() << "ms for " << N << " tasks\n";
+
+        auto futures = core::timeit([&]{
+            pool.submit([&]{
+                std::vector<core::task_future<size_t>> results;
+                results.reserve(N);
+                for (size_t i : core::range(N)) results.push_back(pool.submit([i]{ return i; }));
+                size_t sum = 0;
+                for (auto & r : results) sum += r.get();
+                assert(sum == N*(N-1)/2);
+            }).get();
+        });
+        std::cout << "submit + get from a worker: " << futures.in<ms>() << "ms for " << N << " tasks\n";
+    }
+}
@@ -1,49 +1,329 @@
 #pragma once
 
 #include <thread>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <functional> // invoke
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <system_error>
+#include <cerrno>
+#include <type_traits>
+#include <utility> // forward, move, exchange
+#include <algorithm> // max
+#include "os_detect.hpp"
+#include "cpu.hpp" // p-cores / e-cores
+
+#if defined CORE__LINUX_OS || defined CORE__MAC_OS
+#   include <pthread.h>
+#   include <sched.h>
+#   include <climits> // PTHREAD_STACK_MIN
+#   define CORE_THREAD_PTHREAD
+#endif
+
+#if defined CORE__MAC_OS
+#   include <pthread/qos.h>
+#endif
+
+#if defined CORE__LINUX_OS
+#   include <sys/resource.h> // setpriority
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
 
 namespace core {
 
+/**
+ * @brief which cores of a hybrid cpu a thread should run on
+ * @remark Linux: the affinity is set to the p-core / e-core cpus from sysfs (see device_info/linux_platform.hpp);
+ *         macOS: the QoS class is set (user-interactive runs on p-cores, background is kept on e-cores);
+ *         a machine without hybrid cores (or another OS) ignores it
+ */
+enum class core_class {
+    any,         // wherever the OS likes (the default)
+    performance, // latency-critical work: p-cores
+    efficiency,  // background work: e-cores
+};
+
+/**
+ * @brief how to launch a core::thread: `core::thread t {core::thread_options{}.pin(2).named("consumer"), f, args...};`
+ * @remark an option the platform has no API for is ignored (affinity & nice are Linux-only, the rest needs pthreads),
+ *         an option the system refuses (a cpu that isn't there, SCHED_FIFO without CAP_SYS_NICE, ...) makes the constructor throw
+ */
+struct thread_options {
+    std::vector<unsigned> cpus; // the logical cpus the thread may run on, empty: inherited
+    std::string name;           // shown by top / gdb / perf, Linux keeps the first 15 characters
+    int nice = 0;               // SCHED_OTHER niceness (-20 .. 19), 0: inherited
+    int fifo_priority = 0;      // SCHED_FIFO with this priority (1 .. 99), 0: inherited policy
+    size_t stack_size = 0;      // bytes, 0: the default
+    core_class cores = core_class::any; // ignored if `cpus` are given
+
+    thread_options& pin(unsigned cpu) { cpus = {cpu}; return *this; }
+    thread_options& on(core_class c) { cores = c; return *this; }
+    thread_options& on_cpus(std::vector<unsigned> cpu_set) { cpus = std::move(cpu_set); return *this; }
+    thread_options& named(std::string thread_name) { name = std::move(thread_name); return *this; }
+    thread_options& niceness(int value) { nice = value; return *this; }
+    thread_options& realtime(int priority) { fifo_priority = priority; return *this; }
+    thread_options& stack(size_t bytes) { stack_size = bytes; return *this; }
+};
+
+
+// the calling thread's scheduling knobs; all of them throw std::system_error if the system refuses
+namespace this_thread {
+
+    namespace detail {
+        inline void check(int error, const char* what) {
+            if ( error ) throw std::system_error(error, std::generic_category(), what);
+        }
+    }
+
+    inline void set_affinity(std::vector<unsigned> const& cpus) {
+    #if defined CORE__LINUX_OS
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu : cpus) {
+            if ( cpu >= CPU_SETSIZE ) detail::check(EINVAL, "core::this_thread::set_affinity");
+            CPU_SET(cpu, &set);
+        }
+        detail::check(pthread_setaffinity_np(pthread_self(), sizeof(set), &set), "core::this_thread::set_affinity");
+    #else
+        (void)cpus; // macOS only takes affinity *hints* between threads, not cpu numbers
+    #endif
+    }
+
+    inline void set_name(std::string const& name) {
+    #if defined CORE__LINUX_OS
+        detail::check(pthread_setname_np(pthread_self(), name.substr(0, 15).c_str()), "core::this_thread::set_name");
+    #elif defined CORE__MAC_OS
+        detail::check(pthread_setname_np(name.c_str()), "core::this_thread::set_name");
+    #else
+        (void)name;
+    #endif
+    }
+
+    inline void set_nice(int nice) {
+    #if defined CORE__LINUX_OS
+        // Linux applies the niceness to the single thread (tid), not to the whole process
+        if ( setpriority(PRIO_PROCESS, id_t(syscall(SYS_gettid)), nice) != 0 ) detail::check(errno, "core::this_thread::set_nice");
+    #else
+        (void)nice;
+    #endif
+    }
+
+    inline void set_fifo_priority(int priority) {
+    #if defined CORE_THREAD_PTHREAD
+        sched_param param {};
+        param.sched_priority = priority;
+        detail::check(pthread_setschedparam(pthread_self(), SCHED_FIFO, &param), "core::this_thread::set_fifo_priority");
+    #else
+        (void)priority;
+    #endif
+    }
+
+    // a no-op without hybrid cores, see core_class
+    inline void set_core_class(core_class c) {
+        if ( c == core_class::any || !device::CPU::has_hybrid_cores() ) return;
+    #if defined CORE__LINUX_OS
+        // stays within the cpus the thread is allowed on (taskset, cgroup cpusets), and leaves it alone if none of those is of the class
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if ( pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed) != 0 ) return;
+        std::vector<unsigned> cpus;
+        for (auto cpu : c == core_class::performance ? device::CPU::p_cpus() : device::CPU::e_cpus()) {
+            if ( cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed) ) cpus.push_back(cpu);
+        }
+        if ( !cpus.empty() ) set_affinity(cpus);
+    #elif defined CORE__MAC_OS
+        detail::check(pthread_set_qos_class_self_np(c == core_class::performance ? QOS_CLASS_USER_INTERACTIVE : QOS_CLASS_BACKGROUND, 0),
+                      "core::this_thread::set_core_class");
+    #endif
+    }
+
+    // everything but the stack size (that one is only up to the launcher)
+    inline void apply(thread_options const& options) {
+        if ( !options.cpus.empty() ) set_affinity(options.cpus);
+        else if ( options.cores != core_class::any ) set_core_class(options.cores);
+        if ( !options.name.empty() ) set_name(options.name);
+        if ( options.nice ) set_nice(options.nice);
+        if ( options.fifo_priority ) set_fifo_priority(options.fifo_priority);
+    }
+
+}// namespace this_thread
+
+
+namespace detail {
+
+    template <typename... Ts>
+    struct starts_with_thread_options : std::false_type {};
+
+    template <typename T, typename... Ts>
+    struct starts_with_thread_options<T, Ts...> : std::is_same<std::decay_t<T>, thread_options> {};
+
+#if defined CORE_THREAD_PTHREAD
+    struct thread_body {
+        virtual ~thread_body() = default;
+        virtual void run() = 0;
+    };
+
+    template <typename F, typename... Args>
+    struct thread_call : thread_body {
+        template <typename G, typename... As>
+        thread_call(G && f, As&&... args) : call{std::forward<G>(f), std::forward<As>(args)...} {}
+
+        void run() override { std::apply([](auto & f, auto &... args){ std::invoke(std::move(f), std::move(args)...); }, call); }
+
+        std::tuple<std::decay_t<F>, std::decay_t<Args>...> call;
+    };
+
+    // lives on the launcher's stack until the new thread has applied its options
+    struct thread_launch {
+        thread_launch(thread_options const& options, std::unique_ptr<thread_body> body) : options{options}, body{std::move(body)} {}
+
+        thread_options const& options;
+        std::unique_ptr<thread_body> body;
+
+        std::mutex m;
+        std::condition_variable cv;
+        bool started {false};
+        std::exception_ptr error;
+        std::thread::id id;
+    };
+
+    inline void* thread_entry(void* arg) noexcept {
+        auto * launch = static_cast<thread_launch*>(arg);
+        auto body = std::move(launch->body);
+        std::exception_ptr error;
+        try { core::this_thread::apply(launch->options); }
+        catch (...) { error = std::current_exception(); }
+        {
+            std::lock_guard<std::mutex> lock {launch->m};
+            launch->id = std::this_thread::get_id();
+            launch->error = error;
+            launch->started = true;
+            launch->cv.notify_one(); // under the lock: the launcher can't leave (and take `launch` with it) before this is done
+        }
+        if ( !error ) body->run(); // an escaping exception terminates, as with std::thread
+        return nullptr;
+    }
+#endif
+
+}// namespace detail
+
+
 /**
  * @brief Auto-joinable thread class
  */
 class thread {
     using id = std::thread::id;
     std::thread t;
-public:    
+#if defined CORE_THREAD_PTHREAD
+    // threads launched with thread_options
+    pthread_t native {};
+    id native_id {};
+    bool native_joinable {false};
+#endif
+public:
 
-    template <typename... Ts>
+    template <typename... Ts, typename = std::enable_if_t< !detail::starts_with_thread_options<Ts...>::value >>
     thread (Ts&&... args) noexcept(noexcept( std::thread(std::forward<Ts>(args)...) ))
     : t{ std::forward<Ts>(args)... } {}
 
+    /**
+     * @brief launches f(args...) with the given affinity / name / priority / stack size
+     * @throws std::system_error if the thread can't be created or the system refuses one of the options (f doesn't run then)
+     */
+    template <typename F, typename... Args>
+    thread (thread_options const& options, F && f, Args&&... args) {
+    #if defined CORE_THREAD_PTHREAD
+        detail::thread_launch launch {options, std::make_unique<detail::thread_call<F, Args...>>(std::forward<F>(f), std::forward<Args>(args)...)};
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if ( options.stack_size ) {
+            int error = pthread_attr_setstacksize(&attr, std::max(options.stack_size, size_t(PTHREAD_STACK_MIN)));
+            if ( error ) { pthread_attr_destroy(&attr); this_thread::detail::check(error, "core::thread: stack size"); }
+        }
+        int error = pthread_create(&native, &attr, &detail::thread_entry, &launch);
+        pthread_attr_destroy(&attr);
+        this_thread::detail::check(error, "core::thread: pthread_create");
+
+        std::unique_lock<std::mutex> lock {launch.m};
+        launch.cv.wait(lock, [&]{ return launch.started; });
+        if ( launch.error ) {
+            pthread_join(native, nullptr);
+            std::rethrow_exception(launch.error);
+        }
+        native_id = launch.id;
+        native_joinable = true;
+    #else
+        (void)options;
+        t = std::thread(std::forward<F>(f), std::forward<Args>(args)...);
+    #endif
+    }
+
     thread (thread const&) = delete;
     thread& operator= (thread const&) = delete;
 
+#if defined CORE_THREAD_PTHREAD
+    thread (thread && other) noexcept
+    : t{ std::move(other.t) }, native{ other.native }, native_id{ other.native_id }
+    , native_joinable{ std::exchange(other.native_joinable, false) } {}
+
+    thread& operator= (thread && other) noexcept {
+        if ( joinable() ) std::terminate(); // as std::thread does
+        t = std::move(other.t);
+        native = other.native;
+        native_id = other.native_id;
+        native_joinable = std::exchange(other.native_joinable, false);
+        return *this;
+    }
+#else
     thread (thread && other) = default;
     thread& operator= (thread && other) = default;
+#endif
 
     thread (std::thread && other) : t{ std::move(other) } {}
     thread& operator= (std::thread && other) {
+        if ( joinable() ) std::terminate();
         t = std::move(other);
         return *this;
     }
 
+#if defined CORE_THREAD_PTHREAD
+    bool joinable() const noexcept { return native_joinable || t.joinable(); }
+    auto get_id() const noexcept -> std::thread::id { return native_joinable ? native_id : t.get_id(); }
+    auto native_handle() { return native_joinable ? native : t.native_handle(); }
+
+    void join() {
+        if ( !native_joinable ) return t.join();
+        native_joinable = false;
+        this_thread::detail::check(pthread_join(native, nullptr), "core::thread::join");
+    }
+
+    void detach() {
+        if ( !native_joinable ) return t.detach();
+        native_joinable = false;
+        this_thread::detail::check(pthread_detach(native), "core::thread::detach");
+    }
+#else
     bool joinable() const noexcept { return t.joinable(); }
     auto get_id() const noexcept -> std::thread::id { return t.get_id(); }
     auto native_handle() { return t.native_handle(); }
-    static auto hardware_concurrency() noexcept { return std::thread::hardware_concurrency(); }
 
     void join() { t.join(); }
     void detach() { t.detach(); }
+#endif
+
+    static auto hardware_concurrency() noexcept { return std::thread::hardware_concurrency(); }
 
     ~thread(){
-        if ( t.joinable() ) { t.join(); }
+        if ( joinable() ) { join(); }
     }
 
 };
 
 
-//! TODO: Add mac-specific functions for scheduling on heterogeneous cores of M1 CPU family
-///       using `native_handle`
-
-}//namespace core
\ No newline at end of file
+}//namespace core
@@ -0,0 +1,422 @@
+// Work-stealing thread pool: a fixed set of core::thread workers, each with a Chase-Lev deque of its own (threadsafe/ws_deque.hpp),
+// plus a shared injection queue for the tasks submitted from outside the pool.
+// A worker runs its own tasks LIFO (cache-warm), then takes from the injection queue, then steals FIFO from random victims;
+// with nothing to do it backs off (spin -> yield) and parks on an event count, so an idle pool sleeps.
+// Tasks submitted from inside a task go to the worker's own deque: that path touches nothing shared but the deque
+// (and a fence + load to see if anyone is parked), which keeps the per-task cost well below a microsecond.
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <string>
+#include <tuple>
+#include <optional>
+#include <exception>
+#include <functional> // invoke
+#include <type_traits>
+#include <utility> // move, forward, exchange
+#include <thread>
+#include <iostream> // print_state
+#include "thread.hpp" // core::thread, thread_options
+#include "cpu.hpp" // cacheline_size
+#include "ints.hpp"
+#include "range.hpp"
+#include "threadsafe/ws_deque.hpp"
+#include "threadsafe/queue/mutex_queue.hpp" // SimpleQueue
+#include "threadsafe/auxiliary/event_count.hpp" // event_count, park / unpark, backoff policies
+
+namespace core {
+
+class thread_pool;
+class task_graph;
+
+namespace detail {
+
+    // a type-erased task: a single allocation holds the callable (and, for submit(), the shared result)
+    struct pool_task {
+        void (*execute)(pool_task*);
+    };
+
+    // fire & forget (post): an exception escaping the task terminates, as with std::thread
+    template <typename F>
+    struct posted_task : pool_task {
+        posted_task(F && f) : pool_task{&run}, f{std::move(f)} {}
+
+        static void run(pool_task * t) noexcept {
+            auto * self = static_cast<posted_task*>(t);
+            self->f();
+            delete self;
+        }
+
+        F f;
+    };
+
+
+    template <typename R>
+    struct task_result { std::optional<R> value; };
+
+    template <>
+    struct task_result<void> {};
+
+    // shared by the task and its future, freed by whichever lets go of it last
+    template <typename R>
+    class future_state : public task_result<R> {
+    public:
+        enum status_type : u32 { pending, awaited, ready, failed };
+
+        virtual ~future_state() = default;
+
+        bool done() const noexcept { return status.load(std::memory_order_acquire) >= ready; }
+
+        // parks the calling thread until the task is done
+        void wait() noexcept {
+            auto s = status.load(std::memory_order_acquire);
+            while ( s < ready ) {
+                if ( s == pending && !status.compare_exchange_weak(s, awaited, std::memory_order_acquire) ) continue;
+                detail::park(status, awaited);
+                s = status.load(std::memory_order_acquire);
+            }
+        }
+
+        void release() noexcept {
+            if ( refs.fetch_sub(1, std::memory_order_acq_rel) == 1 ) delete this;
+        }
+
+        std::exception_ptr error;
+
+    protected:
+        void finish(status_type s) noexcept {
+            if ( status.exchange(s, std::memory_order_acq_rel) == awaited ) detail::unpark(status, true);
+        }
+
+    private:
+        std::atomic<u32> status {pending};
+        std::atomic<u32> refs {2}; // the task & the future
+    };
+
+    template <typename F, typename R>
+    struct submitted_task : pool_task, future_state<R> {
+        submitted_task(F && f) : pool_task{&run}, f{std::move(f)} {}
+
+        static void run(pool_task * t) noexcept {
+            auto * self = static_cast<submitted_task*>(t);
+            try {
+                if constexpr (std::is_void<R>::value) self->f();
+                else self->value.emplace(self->f());
+                self->finish(future_state<R>::ready);
+            }
+            catch (...) {
+                self->error = std::current_exception();
+                self->finish(future_state<R>::failed);
+            }
+            self->release();
+        }
+
+        F f;
+    };
+
+
+    // which pool (if any) the current thread works for
+    struct pool_worker_context {
+        thread_pool * pool {nullptr};
+        size_t index {0};
+    };
+
+    inline pool_worker_context & this_pool_worker() noexcept {
+        thread_local pool_worker_context context;
+        return context;
+    }
+
+}// namespace detail
+
+
+/**
+ * @brief the result of a thread_pool::submit(): move-only, get() once (like std::future, without the locks)
+ * @remark waiting on a pool worker runs other tasks of the pool meanwhile, so tasks may wait for the tasks they submitted
+ */
+template <typename R>
+class task_future {
+public:
+    task_future() = default;
+    explicit task_future(detail::future_state<R> * state) noexcept : state{state} {}
+
+    task_future(task_future && other) noexcept : state{std::exchange(other.state, nullptr)} {}
+    task_future& operator= (task_future && other) noexcept {
+        if ( this != &other ) {
+            if ( state ) state->release();
+            state = std::exchange(other.state, nullptr);
+        }
+        return *this;
+    }
+
+    task_future(task_future const&) = delete;
+    task_future& operator= (task_future const&) = delete;
+
+    ~task_future() { if ( state ) state->release(); }
+
+    bool valid() const noexcept { return state != nullptr; }
+    bool ready() const noexcept { return state->done(); }
+
+    void wait() const;
+
+    /**
+     * @brief waits for the task, returns its result or rethrows its exception; the future is empty afterwards
+     */
+    R get() {
+        wait();
+        std::unique_ptr<detail::future_state<R>, releaser> owned {std::exchange(state, nullptr)};
+        if ( owned->error ) std::rethrow_exception(owned->error);
+        if constexpr (!std::is_void<R>::value) return std::move(*owned->value);
+    }
+
+private:
+    struct releaser { void operator() (detail::future_state<R> * s) const noexcept { s->release(); } };
+
+    detail::future_state<R> * state {nullptr};
+};
+
+
+/**
+ * @brief fixed-size work-stealing executor
+ */
+class thread_pool {
+    using task_ptr = detail::pool_task*;
+    using backoff_type = core::default_backoff;
+
+    struct alignas(core::device::CPU::cacheline_size) worker {
+        ws_deque<task_ptr> tasks {256};
+    };
+
+public:
+    static constexpr size_t npos = size_t(-1);
+
+    struct pool_closed : std::exception {
+        const char* what() const noexcept override { return "submit() to a thread pool that is shut down"; }
+    };
+
+    explicit thread_pool(size_t n_threads = core::thread::hardware_concurrency()) : thread_pool(n_threads, thread_options{}) {}
+
+    /**
+     * @param worker_options how to launch the workers (see thread.hpp), e.g. `thread_options{}.on(core_class::efficiency)`
+     *        for a background pool; a name gets the worker's index appended
+     */
+    thread_pool(size_t n_threads, thread_options const& worker_options) {
+        if ( n_threads == 0 ) n_threads = 1;
+        workers.reserve(n_threads);
+        for (size_t i : core::range(n_threads)) { (void)i; workers.emplace_back(new worker); }
+        threads.reserve(n_threads);
+        try {
+            for (size_t i : core::range(n_threads)) {
+                auto options = worker_options;
+                if ( !options.name.empty() ) options.name += "-" + std::to_string(i);
+                threads.emplace_back(options, [this, i]{ run(i); });
+            }
+        }
+        catch (...) { // the system refused an option: stop the workers that did start
+            shutdown();
+            throw;
+        }
+    }
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator= (thread_pool const&) = delete;
+
+    ~thread_pool() { shutdown(); }
+
+
+    /**
+     * @brief schedules f(args...), returns a task_future for its result
+     * @throws pool_closed if called from outside the pool after shutdown()
+     */
+    template <typename F, typename... Args>
+    auto submit(F && f, Args&&... args) {
+        using result_type = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+        auto call = bind(std::forward<F>(f), std::forward<Args>(args)...);
+        using task_type = detail::submitted_task<decltype(call), result_type>;
+
+        task_future<result_type> future;
+        schedule([&]{
+            auto * task = new task_type(std::move(call));
+            future = task_future<result_type>{task};
+            return task;
+        });
+        return future;
+    }
+
+    /**
+     * @brief schedules f(args...) with no future to wait on (cheaper than submit), an exception escaping f terminates
+     * @throws pool_closed if called from outside the pool after shutdown()
+     */
+    template <typename F, typename... Args>
+    void post(F && f, Args&&... args) {
+        auto call = bind(std::forward<F>(f), std::forward<Args>(args)...);
+        schedule([&]{ return new detail::posted_task<decltype(call)>(std::move(call)); });
+    }
+
+    /**
+     * @brief runs one pending task on the calling pool worker
+     * @return false if there was nothing to run (or the calling thread isn't a worker of this pool)
+     */
+    bool run_one() {
+        auto & context = detail::this_pool_worker();
+        if ( context.pool != this ) return false;
+        if ( auto * task = find_task(context.index) ) { task->execute(task); return true; }
+        return false;
+    }
+
+    /**
+     * @brief graceful shutdown: stops accepting tasks from outside the pool, runs everything already scheduled
+     *        (and whatever those tasks schedule), joins the workers. Called by the destructor, must not be called by a worker.
+     */
+    void shutdown() {
+        if ( threads.empty() ) return;
+        closing.store(true, std::memory_order_seq_cst);
+        while ( submitting.load(std::memory_order_seq_cst) != 0 ) std::this_thread::yield(); // let the accepted submits land
+        stopping.store(true, std::memory_order_release);
+        work_available.notify_all();
+        threads.clear(); // joins
+    }
+
+    size_t size() const noexcept { return workers.size(); }
+
+    // the pool the calling thread is a worker of, nullptr for other threads
+    static thread_pool * current() noexcept { return detail::this_pool_worker().pool; }
+
+    // the calling worker's index in [0, size()), npos for other threads
+    static size_t worker_index() noexcept {
+        auto & context = detail::this_pool_worker();
+        return context.pool ? context.index : npos;
+    }
+
+
+    void print_state() const {
+        std::cerr << "TP: " << size() << " workers | injected: " << n_injected.load() << " | closing: " << std::boolalpha << closing.load() << "\n";
+        for (auto & w : workers) { std::cerr << "  "; w->tasks.print_state(); }
+    }
+
+private:
+    friend class task_graph; // schedules its nodes, which it owns, directly
+
+    // f(args...) as a nullary callable owning copies of f & args
+    template <typename F, typename... Args>
+    static auto bind(F && f, Args&&... args) {
+        if constexpr (sizeof...(Args) == 0) {
+            return std::decay_t<F>(std::forward<F>(f));
+        } else {
+            return [f = std::forward<F>(f), args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                return std::apply(std::move(f), std::move(args));
+            };
+        }
+    }
+
+    template <typename MakeTask>
+    void schedule(MakeTask && make_task) {
+        auto & context = detail::this_pool_worker();
+        if ( context.pool == this ) { // a task spawning more: straight into the worker's own deque
+            workers[context.index]->tasks.push(make_task());
+        }
+        else {
+            submitting.fetch_add(1, std::memory_order_seq_cst);
+            if ( closing.load(std::memory_order_seq_cst) ) {
+                submitting.fetch_sub(1, std::memory_order_seq_cst);
+                throw pool_closed{};
+            }
+            n_injected.fetch_add(1, std::memory_order_relaxed); // before the push: the counter never goes below the queue size
+            try { injected.push(make_task()); }
+            catch (...) {
+                // nothing got queued (the task's allocation or construction threw): undo the counts,
+                // or shutdown() would wait for this submit forever and the workers would never see the pool idle
+                n_injected.fetch_sub(1, std::memory_order_relaxed);
+                submitting.fetch_sub(1, std::memory_order_seq_cst);
+                throw;
+            }
+            submitting.fetch_sub(1, std::memory_order_seq_cst);
+        }
+        work_available.notify_one();
+    }
+
+    // own deque (LIFO) -> injection queue -> steal (FIFO) from the others, starting at a random one
+    task_ptr find_task(size_t self) {
+        task_ptr task;
+        if ( workers[self]->tasks.pop(task) ) return task;
+
+        if ( n_injected.load(std::memory_order_acquire) > 0 && injected.try_pop(task) ) {
+            n_injected.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        }
+
+        const auto n = workers.size();
+        const auto start = size_t(random() % n);
+        for (size_t k : core::range(n)) {
+            auto victim = (start + k) % n;
+            if ( victim != self && workers[victim]->tasks.steal(task) ) return task;
+        }
+        return nullptr;
+    }
+
+    bool has_work() const {
+        if ( n_injected.load(std::memory_order_acquire) > 0 ) return true;
+        for (auto & w : workers) if ( !w->tasks.empty() ) return true;
+        return false;
+    }
+
+    void run(size_t self) {
+        detail::this_pool_worker() = {this, self};
+        backoff_type backoff;
+        for (;;) {
+            if ( auto * task = find_task(self) ) {
+                task->execute(task);
+                backoff.reset();
+                continue;
+            }
+            if ( stopping.load(std::memory_order_acquire) && !has_work() ) break;
+            if ( !backoff() ) continue;
+
+            auto key = work_available.prepare_wait();
+            if ( has_work() || stopping.load(std::memory_order_acquire) ) { work_available.cancel_wait(); continue; }
+            work_available.wait(key);
+            backoff.reset();
+        }
+        detail::this_pool_worker() = {};
+    }
+
+    // per-thread xorshift64, for picking victims
+    static u64 random() noexcept {
+        thread_local u64 state = 0x9E3779B97F4A7C15ull ^ std::hash<std::thread::id>{}(std::this_thread::get_id());
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    std::vector<std::unique_ptr<worker>> workers;
+
+    SimpleQueue<task_ptr> injected; // tasks from outside the pool
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<size_t> n_injected {0}; // lets the workers skip the queue's lock while it's empty
+
+    alignas(core::device::CPU::cacheline_size)
+    core::event_count work_available; // idle workers park here
+    std::atomic<bool> closing {false};  // no more tasks from outside
+    std::atomic<bool> stopping {false}; // no more tasks from outside, and the accepted ones are all in the queues
+    std::atomic<size_t> submitting {0};
+
+    std::vector<core::thread> threads; // last: joined (by shutdown) before the rest goes away
+};
+
+
+template <typename R>
+void task_future<R>::wait() const {
+    if ( state->done() ) return;
+    if ( auto * pool = thread_pool::current() ) { // help out instead of blocking the worker
+        core::default_backoff backoff;
+        while ( !state->done() ) {
+            if ( pool->run_one() ) { backoff.reset(); continue; }
+            if ( backoff() ) break;
+        }
+    }
+    state->wait();
+}
+
+}// namespace core
@@ -0,0 +1,96 @@
+// Backoff policies shared by the spinning queues in threadsafe/
+// exponential pause-spinning -> a bounded number of yields -> parking (or yielding forever if parking is off)
+#pragma once
+
+#include <thread>
+#include "../../compiler_detect.hpp"
+#include "../../ints.hpp"
+
+#if (defined _M_X64 || defined _M_IX86) && defined CORE_MSVC
+#   include <intrin.h> // _mm_pause
+#endif
+
+namespace core {
+
+/**
+ * @brief a spin-wait hint for the CPU (x86 `pause` / ARM `yield`), a no-op elsewhere
+ */
+inline void cpu_relax() noexcept {
+#if (__x86_64__ || __amd64__ || __i386__) && (defined CORE_GCC || defined CORE_CLANG)
+    __builtin_ia32_pause();
+#elif (defined _M_X64 || defined _M_IX86) && defined CORE_MSVC
+    _mm_pause();
+#elif (__aarch64__ || __arm__) && (defined CORE_GCC || defined CORE_CLANG)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+
+/**
+ * @brief Exponential backoff policy:
+ *        spins with 1, 2, 4, ... MaxSpins cpu_relax()-es, then yields MaxYields times,
+ *        then asks the caller to park (Park) or keeps on yielding (!Park)
+ * @remark Park = false lets the queues skip the wake-up notifications on the hot path entirely
+ */
+template <u32 MaxSpins = 64, u32 MaxYields = 16, bool Park = true>
+class backoff {
+public:
+    static constexpr bool parks = Park;
+
+    /**
+     * @brief one backoff step
+     * @return true if the caller should park now
+     */
+    bool operator() () noexcept {
+        if (spins <= MaxSpins) {
+            for (u32 i = 0; i < spins; ++i) cpu_relax();
+            spins *= 2;
+            return false;
+        }
+        if (Park && yields >= MaxYields) return true;
+        ++yields;
+        std::this_thread::yield();
+        return false;
+    }
+
+    void reset() noexcept { spins = 1; yields = 0; }
+
+    // the next step is a spin (not a yield or a park)
+    bool spinning() const noexcept { return spins <= MaxSpins; }
+
+private:
+    u32 spins {1};
+    u32 yields {0};
+};
+
+
+/**
+ * @brief retries try_op() with the Backoff policy until it succeeds,
+ *        for the queues that have nothing to park on the park step is a yield
+ */
+template <class Backoff, typename TryOp>
+void spin_wait(TryOp && try_op) {
+    Backoff backoff;
+    while ( !try_op() ) {
+        if ( backoff() ) std::this_thread::yield();
+    }
+}
+
+// same, reports the yields to the queue's stats policy (see queue_stats.hpp)
+template <class Backoff, typename TryOp, class Stats>
+void spin_wait(TryOp && try_op, Stats & stats) {
+    Backoff backoff;
+    while ( !try_op() ) {
+        const bool spinning = backoff.spinning();
+        if ( backoff() ) std::this_thread::yield();
+        if ( !spinning ) stats.yielded();
+    }
+}
+
+
+// The queues default to spin_backoff: a parking Backoff costs every successful try-op a fence + a load (to wake the parked),
+// so non-blocking users don't pay for it unless they opt in with default_backoff (or another backoff<..., true>).
+using default_backoff = backoff<>;              // spin -> yield -> park
+using spin_backoff    = backoff<64, 0, false>;  // spin -> yield, never parks: lowest latency, burns the core while waiting
+
+}// namespace core
@@ -0,0 +1,122 @@
+// Event count: lets a thread park until some other thread signals progress (push / pop / close)
+// without adding anything but a fence and a load to the signalling side when nobody is waiting.
+// Uses C++20 atomic::wait where available, a futex on Linux and falls back to yielding otherwise.
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <climits>
+#include "../../ints.hpp"
+#include "backoff.hpp"
+#include "queue_stats.hpp" // no_stats
+
+#if !(defined __cpp_lib_atomic_wait && __cplusplus >= __cpp_lib_atomic_wait) && defined __linux__
+#   include <linux/futex.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#   define CORE_USE_FUTEX
+#endif
+
+namespace core {
+
+namespace detail {
+
+    inline void park(std::atomic<u32> & word, u32 expected) noexcept {
+    #if defined __cpp_lib_atomic_wait && __cplusplus >= __cpp_lib_atomic_wait
+        word.wait(expected, std::memory_order_acquire);
+    #elif defined CORE_USE_FUTEX
+        static_assert(sizeof(std::atomic<u32>) == sizeof(u32), "futex needs a plain 32-bit word");
+        syscall(SYS_futex, reinterpret_cast<u32*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    #else
+        if (word.load(std::memory_order_acquire) == expected) std::this_thread::yield();
+    #endif
+    }
+
+    inline void unpark(std::atomic<u32> & word, bool all) noexcept {
+    #if defined __cpp_lib_atomic_wait && __cplusplus >= __cpp_lib_atomic_wait
+        if (all) word.notify_all(); else word.notify_one();
+    #elif defined CORE_USE_FUTEX
+        syscall(SYS_futex, reinterpret_cast<u32*>(&word), FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, nullptr, nullptr, 0);
+    #else
+        (void)word; (void)all;
+    #endif
+    }
+
+}// namespace detail
+
+
+/**
+ * @brief Event count (a-la Dekker/eventcount from folly and D.Vyukov):
+ *        waiter: key = prepare_wait(); re-check the condition; then either cancel_wait() or wait(key)
+ *        notifier: make the condition true; then notify_one() / notify_all()
+ */
+class event_count {
+public:
+    using key_type = u32;
+
+    key_type prepare_wait() noexcept {
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the fence in notify()
+        return epoch.load(std::memory_order_acquire);
+    }
+
+    void cancel_wait() noexcept { waiters.fetch_sub(1, std::memory_order_relaxed); }
+
+    void wait(key_type key) noexcept {
+        while (epoch.load(std::memory_order_acquire) == key) {
+            detail::park(epoch, key);
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify_one() noexcept { notify(false); }
+    void notify_all() noexcept { notify(true); }
+
+private:
+    void notify(bool all) noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) != 0) {
+            epoch.fetch_add(1, std::memory_order_release);
+            detail::unpark(epoch, all);
+        }
+    }
+
+    std::atomic<u32> epoch {0};
+    std::atomic<u32> waiters {0};
+};
+
+
+/**
+ * @brief retries try_op() with the Backoff policy (see backoff.hpp) until it succeeds or stop() becomes true, 
+ *        parks on `ec` once the policy says so; the yields & parks are reported to `stats` (see queue_stats.hpp)
+ * @return true if try_op() succeeded, false if the wait was stopped
+ */
+template <class Backoff, typename TryOp, typename Stop, class Stats>
+bool blocking_wait(event_count & ec, TryOp && try_op, Stop && stop, Stats & stats) {
+    Backoff backoff;
+    for (;;) {
+        if ( try_op() ) return true;
+        if ( stop() ) return try_op();
+
+        const bool spinning = backoff.spinning();
+        if ( !backoff() ) {
+            if ( !spinning ) stats.yielded();
+            continue;
+        }
+
+        auto key = ec.prepare_wait();
+        if ( try_op() ) { ec.cancel_wait(); return true; }
+        if ( stop() ) { ec.cancel_wait(); return try_op(); }
+        stats.parked();
+        ec.wait(key);
+        backoff.reset();
+    }
+}
+
+template <class Backoff, typename TryOp, typename Stop>
+bool blocking_wait(event_count & ec, TryOp && try_op, Stop && stop) {
+    no_stats none;
+    return blocking_wait<Backoff>(ec, try_op, stop, none);
+}
+
+}// namespace core
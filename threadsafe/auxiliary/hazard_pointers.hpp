@@ -0,0 +1,110 @@
+// Hazard pointers (M.Michael, "Hazard Pointers: Safe Memory Reclamation for Lock-Free Objects", 2004)
+// A minimal single-hazard-per-record domain: every thread (or descriptor) that touches the shared nodes owns a record,
+// protect()-s the node it's about to dereference and retire()-s the nodes it has unlinked.
+// A retired node is deleted once no record points at it. Records are never freed before the domain, they are reused instead.
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <algorithm> // sort, binary_search
+#include "../../cpu.hpp" // cacheline_size
+
+namespace core {
+
+template <typename Node>
+class hazard_domain {
+public:
+    struct alignas(core::device::CPU::cacheline_size) record {
+        std::atomic<Node*> hazard {nullptr};
+        std::atomic<bool> in_use {true};
+        std::vector<Node*> retired; // owned by the record's current user
+        record * next {nullptr};    // immutable once the record is published
+    };
+
+    hazard_domain() = default;
+    hazard_domain(hazard_domain const&) = delete;
+    hazard_domain& operator= (hazard_domain const&) = delete;
+
+    ~hazard_domain() {
+        auto * rec = records.load(std::memory_order_acquire);
+        while (rec) {
+            for (auto * node : rec->retired) delete node;
+            auto * next = rec->next;
+            delete rec;
+            rec = next;
+        }
+    }
+
+    /**
+     * @brief grabs a free record or publishes a new one
+     */
+    record * acquire() {
+        for (auto * rec = records.load(std::memory_order_acquire); rec; rec = rec->next) {
+            bool free = false;
+            if ( !rec->in_use.load(std::memory_order_relaxed)
+              && rec->in_use.compare_exchange_strong(free, true, std::memory_order_acquire) ) {
+                return rec;
+            }
+        }
+        auto * rec = new record;
+        rec->next = records.load(std::memory_order_relaxed);
+        while ( !records.compare_exchange_weak(rec->next, rec, std::memory_order_release, std::memory_order_relaxed) );
+        n_records.fetch_add(1, std::memory_order_relaxed);
+        return rec;
+    }
+
+    void release(record * rec) {
+        rec->hazard.store(nullptr, std::memory_order_release);
+        rec->in_use.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @brief loads src and publishes it as the record's hazard, re-loading until the published value is still current
+     */
+    Node * protect(record & rec, std::atomic<Node*> const& src) {
+        auto * node = src.load(std::memory_order_relaxed);
+        for (;;) {
+            // both seq_cst: the re-load can't move ahead of the publish (StoreLoad), an acquire load could (POWER, ARM ldapr)
+            rec.hazard.store(node, std::memory_order_seq_cst);
+            auto * current = src.load(std::memory_order_seq_cst);
+            if ( current == node ) return node;
+            node = current;
+        }
+    }
+
+    void clear(record & rec) { rec.hazard.store(nullptr, std::memory_order_release); }
+
+    /**
+     * @brief the node has been unlinked, delete it once nobody's got it protected
+     */
+    void retire(record & rec, Node * node) {
+        rec.retired.push_back(node);
+        if ( rec.retired.size() >= scan_threshold() ) scan(rec);
+    }
+
+private:
+    size_t scan_threshold() const { return 2 * n_records.load(std::memory_order_relaxed) + 8; }
+
+    void scan(record & rec) {
+        // Pairs with the seq_cst store + re-load in protect(): the unlink before retire() precedes this fence, so either the re-load
+        // sees the unlink (and protect() retries) or the hazard store precedes the fence and the loads below see it.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        std::vector<Node*> hazards;
+        for (auto * r = records.load(std::memory_order_acquire); r; r = r->next) {
+            if ( auto * h = r->hazard.load(std::memory_order_acquire) ) hazards.push_back(h);
+        }
+        std::sort(hazards.begin(), hazards.end());
+
+        auto still_hazardous = std::partition(rec.retired.begin(), rec.retired.end(), [&](Node * node){
+            return std::binary_search(hazards.begin(), hazards.end(), node);
+        });
+        for (auto it = still_hazardous; it != rec.retired.end(); ++it) delete *it;
+        rec.retired.erase(still_hazardous, rec.retired.end());
+    }
+
+    std::atomic<record*> records {nullptr};
+    std::atomic<size_t> n_records {0};
+};
+
+}// namespace core
@@ -0,0 +1,162 @@
+// Stats policies for the queues (the last `Stats` template parameter):
+//  - core::no_stats: the default, empty and all no-ops, takes no space in the queue (NO_UNIQUE_ADDRESS);
+//  - core::queue_stats<>: relaxed counters striped over cacheline-sized per-thread blocks (pushes, pops, failed try-ops,
+//    CAS failures, yields, parks) plus a histogram of the queue occupancy sampled every SampleEvery-th push of a thread.
+//    The occupancy is estimated from the counters themselves (pushes - pops so far), so it works the same for every queue
+//    and never touches the queue's indices.
+// The queues report to it through the hooks below, `queue.counters().snapshot()` sums the stripes up.
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <string> // to_string
+#include <iostream>
+#include "../../cpu.hpp" // cacheline_size
+#include "../../ints.hpp"
+#include "../../range.hpp"
+
+namespace core {
+
+/**
+ * @brief summed-up queue counters
+ * @remark occupancy[0] counts the samples of an empty queue, occupancy[k] the samples with [2^(k-1), 2^k) elements
+ */
+struct queue_stats_snapshot {
+    static constexpr size_t occupancy_buckets = 32;
+
+    u64 pushes {0};
+    u64 pops {0};
+    u64 try_push_failures {0}; // try-pushes that found the queue full or lost a race
+    u64 try_pop_failures {0};  // try-pops that found the queue empty or lost a race
+    u64 cas_failures {0};
+    u64 yields {0};            // blocking push / pop backoff steps that yielded the cpu
+    u64 parks {0};             // blocking push / pop waits that parked the thread
+    std::array<u64, occupancy_buckets> occupancy {};
+
+    static size_t bucket_of(size_t occupancy) noexcept {
+        size_t k = 0;
+        while ( occupancy && k < occupancy_buckets - 1 ) { occupancy >>= 1; ++k; }
+        return k;
+    }
+
+    friend std::ostream& operator<< (std::ostream & os, queue_stats_snapshot const& s) {
+        os << "pushes: " << s.pushes << " pops: " << s.pops
+           << " | failed try_push: " << s.try_push_failures << " try_pop: " << s.try_pop_failures
+           << " | CAS failures: " << s.cas_failures << " | yields: " << s.yields << " parks: " << s.parks
+           << "\noccupancy:";
+        for (size_t k : core::range(occupancy_buckets)) {
+            if ( !s.occupancy[k] ) continue;
+            os << (k == 0 ? " [0]: " : " [" + std::to_string(size_t(1) << (k-1)) + ", " + std::to_string(size_t(1) << k) + "): ")
+               << s.occupancy[k];
+        }
+        return os;
+    }
+};
+
+
+/**
+ * @brief the default stats policy: no counters at all
+ */
+struct no_stats {
+    static constexpr bool enabled = false;
+
+    void pushed(u64 = 1) noexcept {}
+    void popped(u64 = 1) noexcept {}
+    void push_failed() noexcept {}
+    void pop_failed() noexcept {}
+    void cas_failed() noexcept {}
+    void yielded() noexcept {}
+    void parked() noexcept {}
+
+    queue_stats_snapshot snapshot() const noexcept { return {}; }
+    void reset() noexcept {}
+};
+
+
+namespace detail {
+    // a small per-thread number to pick a stripe with
+    inline size_t stats_thread_slot() noexcept {
+        static std::atomic<size_t> n_threads {0};
+        thread_local const size_t slot = n_threads.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+}// namespace detail
+
+
+/**
+ * @brief per-thread (striped) relaxed counters & a sampled occupancy histogram
+ * @param Stripes counter blocks, threads beyond that share them
+ * @param SampleEvery a thread samples the occupancy on every SampleEvery-th push of its own
+ */
+template <size_t Stripes = 16, size_t SampleEvery = 64>
+class queue_stats {
+    static_assert(Stripes > 0 && SampleEvery > 0, "need at least one stripe and a non-zero sampling period");
+
+    enum counter : size_t { pushes, pops, push_failures, pop_failures, cas_failures, yields, parks, n_counters };
+
+    struct alignas(core::device::CPU::cacheline_size) stripe {
+        std::atomic<u64> counters[n_counters] {};
+        std::atomic<u64> occupancy[queue_stats_snapshot::occupancy_buckets] {};
+    };
+
+public:
+    static constexpr bool enabled = true;
+
+    void pushed(u64 n = 1) noexcept {
+        auto & s = mine();
+        auto before = s.counters[pushes].fetch_add(n, std::memory_order_relaxed);
+        if ( before / SampleEvery != (before + n) / SampleEvery ) {
+            s.occupancy[queue_stats_snapshot::bucket_of(in_flight())].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void popped(u64 n = 1) noexcept { mine().counters[pops].fetch_add(n, std::memory_order_relaxed); }
+    void push_failed() noexcept { bump(push_failures); }
+    void pop_failed() noexcept  { bump(pop_failures); }
+    void cas_failed() noexcept  { bump(cas_failures); }
+    void yielded() noexcept     { bump(yields); }
+    void parked() noexcept      { bump(parks); }
+
+    // consistent per counter, not across the counters (they keep running)
+    queue_stats_snapshot snapshot() const noexcept {
+        queue_stats_snapshot snap;
+        for (auto & s : stripes) {
+            snap.pushes            += s.counters[pushes].load(std::memory_order_relaxed);
+            snap.pops              += s.counters[pops].load(std::memory_order_relaxed);
+            snap.try_push_failures += s.counters[push_failures].load(std::memory_order_relaxed);
+            snap.try_pop_failures  += s.counters[pop_failures].load(std::memory_order_relaxed);
+            snap.cas_failures      += s.counters[cas_failures].load(std::memory_order_relaxed);
+            snap.yields            += s.counters[yields].load(std::memory_order_relaxed);
+            snap.parks             += s.counters[parks].load(std::memory_order_relaxed);
+            for (size_t k : core::range(queue_stats_snapshot::occupancy_buckets)) {
+                snap.occupancy[k] += s.occupancy[k].load(std::memory_order_relaxed);
+            }
+        }
+        return snap;
+    }
+
+    void reset() noexcept {
+        for (auto & s : stripes) {
+            for (auto & c : s.counters) c.store(0, std::memory_order_relaxed);
+            for (auto & c : s.occupancy) c.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    // pushes - pops over all the stripes: approximate while the queue is in use
+    size_t in_flight() const noexcept {
+        u64 in = 0, out = 0;
+        for (auto & s : stripes) {
+            out += s.counters[pops].load(std::memory_order_relaxed);
+            in  += s.counters[pushes].load(std::memory_order_relaxed);
+        }
+        return in > out ? size_t(in - out) : 0;
+    }
+
+    stripe & mine() noexcept { return stripes[detail::stats_thread_slot() % Stripes]; }
+    void bump(counter c) noexcept { mine().counters[c].fetch_add(1, std::memory_order_relaxed); }
+
+    stripe stripes[Stripes];
+};
+
+}// namespace core
@@ -0,0 +1,126 @@
+// A growable FIFO on a contiguous power-of-two ring (a single-threaded std::queue replacement without deque's chunk allocations)
+// The slots are uninitialized storage: elements are placement-constructed on push and destroyed on pop / clear / grow,
+// so T doesn't have to be default-constructible and nothing popped is kept alive by the buffer.
+#pragma once
+
+#include <memory> // allocator
+#include <new> // placement new
+#include <utility> // move, swap, exchange
+#include <stdexcept> // length_error
+#include "../../bits.hpp" // ceil_pow2
+
+namespace core {
+
+template <typename T>
+class ring_buffer {
+public:
+    using value_type = T;
+
+    ring_buffer(size_t capacity=16) : cap{core::ceil_pow2(capacity < 2 ? 2 : capacity)} {
+        if (cap == 0) throw std::length_error("ring_buffer: capacity too large");
+        slots = std::allocator<T>{}.allocate(cap);
+        mask = cap - 1;
+    }
+
+    ring_buffer(ring_buffer const& other) : ring_buffer(other.cap) {
+        for (size_t i = 0; i < other.count; ++i) push_back(other[i]);
+    }
+
+    // the moved-from buffer is empty, with no storage (the next push allocates)
+    ring_buffer(ring_buffer && other) noexcept
+    : slots{std::exchange(other.slots, nullptr)}
+    , cap{std::exchange(other.cap, 0)}
+    , mask{std::exchange(other.mask, 0)}
+    , head{std::exchange(other.head, 0)}
+    , count{std::exchange(other.count, 0)}
+    {}
+
+    ring_buffer& operator= (ring_buffer other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~ring_buffer() {
+        clear();
+        if (slots) std::allocator<T>{}.deallocate(slots, cap);
+    }
+
+    void push_back(T const& v) {
+        if (count == cap) grow();
+        new (slot(count)) T(v);
+        ++count;
+    }
+
+    void push_back(T && v) {
+        if (count == cap) grow();
+        new (slot(count)) T(std::move(v));
+        ++count;
+    }
+
+    T& front() { return *slot(0); }
+    T const& front() const { return *slot(0); }
+
+    void pop_front() {
+        slot(0)->~T();
+        head = (head + 1) & mask;
+        --count;
+    }
+
+    // i-th element from the front
+    T& operator[] (size_t i) { return *slot(i); }
+    T const& operator[] (size_t i) const { return *slot(i); }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return cap; }
+    bool empty() const { return count == 0; }
+
+    // destroys the elements, keeps the storage
+    void clear() {
+        for (size_t i = 0; i < count; ++i) slot(i)->~T();
+        head = 0;
+        count = 0;
+    }
+
+    void swap(ring_buffer & other) noexcept {
+        std::swap(slots, other.slots);
+        std::swap(cap, other.cap);
+        std::swap(mask, other.mask);
+        std::swap(head, other.head);
+        std::swap(count, other.count);
+    }
+
+private:
+    T * slot(size_t i) const { return slots + ((head + i) & mask); }
+
+    // moves the elements to the front of a ring twice as large, destroys the old ones
+    void grow() {
+        const size_t bigger_cap = cap ? 2 * cap : 2;
+        if (bigger_cap < cap) throw std::length_error("ring_buffer: capacity too large");
+        T * bigger = std::allocator<T>{}.allocate(bigger_cap);
+        size_t moved = 0;
+        try {
+            for (; moved < count; ++moved) new (bigger + moved) T(std::move_if_noexcept(*slot(moved)));
+        }
+        catch (...) {
+            for (size_t i = 0; i < moved; ++i) bigger[i].~T();
+            std::allocator<T>{}.deallocate(bigger, bigger_cap);
+            throw;
+        }
+
+        const size_t n = count;
+        clear();
+        if (slots) std::allocator<T>{}.deallocate(slots, cap);
+        slots = bigger;
+        cap = bigger_cap;
+        mask = cap - 1;
+        count = n;
+    }
+
+    T * slots {nullptr};
+    size_t cap;
+    size_t mask;
+    size_t head {0};
+    size_t count {0};
+};
+
+}// namespace core
@@ -0,0 +1,78 @@
+// Slot layout policies for the tagged-slot rings (bounded_mpmc):
+// how the slots are laid out in memory and how a ring index maps onto a slot.
+// Small slots are packed several to a cacheline, so producers and consumers working on neighbouring
+// indices keep bouncing the same line between cores (false sharing). Two ways around it:
+//  - padded:    one slot per cacheline, costs cacheline_size bytes per slot
+//  - scattered: keeps the dense array, but remaps the indices so that consecutive ones land on different lines
+#pragma once
+
+#include <cstddef>
+#include "../../cpu.hpp" // cacheline_size
+#include "../../bits.hpp" // is_pow2, log2
+
+namespace core {
+
+/**
+ * @brief T aligned (and thus padded) to a whole cacheline
+ */
+template <typename T>
+struct alignas(core::device::CPU::cacheline_size) cacheline_padded : T {
+    using T::T;
+    cacheline_padded() = default;
+};
+
+
+namespace slot_layout {
+
+    /**
+     * @brief slots packed densely, index i is slot i
+     */
+    struct dense {
+        template <typename Slot, size_t N>
+        struct bind {
+            using slot_type = Slot;
+            static constexpr size_t map(size_t i) noexcept { return i; }
+        };
+    };
+
+
+    /**
+     * @brief every slot gets a cacheline of its own, index i is slot i
+     */
+    struct padded {
+        template <typename Slot, size_t N>
+        struct bind {
+            using slot_type = cacheline_padded<Slot>;
+            static constexpr size_t map(size_t i) noexcept { return i; }
+        };
+    };
+
+
+    /**
+     * @brief slots packed densely, consecutive indices are spread over the cachelines (a-la atomic_queue's remap_index):
+     *        index i goes to line (i % n_lines), position (i / n_lines) within the line
+     * @remark requires a power-of-two N, the remap is then a swap of two bit-fields of the index
+     */
+    struct scattered {
+        template <typename Slot, size_t N>
+        struct bind {
+            static_assert(core::is_pow2(N), "scattered slot layout needs a power-of-two N");
+            using slot_type = Slot;
+
+        private:
+            // slots per cacheline, rounded down to a power of two (and capped by N)
+            static constexpr size_t fit = sizeof(Slot) < size_t(core::device::CPU::cacheline_size) ? size_t(core::device::CPU::cacheline_size) / sizeof(Slot) : 1;
+            static constexpr size_t per_line = (size_t(1) << core::log2(fit)) < N ? (size_t(1) << core::log2(fit)) : N;
+            static constexpr unsigned line_bits = core::log2(N / per_line);
+            static constexpr unsigned slot_bits = core::log2(per_line);
+
+        public:
+            static constexpr size_t map(size_t i) noexcept {
+                return ((i & ((size_t(1) << line_bits) - 1)) << slot_bits) | (i >> line_bits);
+            }
+        };
+    };
+
+}// namespace slot_layout
+
+}// namespace core
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+namespace core {
+
+/**
+ * @brief A handle to a ring slot handed out by reserve() / peek()
+ * @remark empty (false) if there was no slot available,
+ *         the index is opaque and only meaningful to the queue that issued the handle
+ */
+template <typename T, typename index_type=size_t>
+struct slot_ref {
+    using value_type = T;
+
+    slot_ref() = default;
+    slot_ref(T * ptr, index_type idx) : data{ptr}, index{idx} {}
+
+    T& operator* () const noexcept { return *data; }
+    T* operator-> () const noexcept { return data; }
+
+    explicit operator bool () const noexcept { return data != nullptr; }
+
+    T * data {nullptr};
+    index_type index {0};
+};
+
+}// namespace core
@@ -18,8 +18,13 @@ The views and conclusions contained in the software and documentation are those
 
 #include <atomic>
 #include <vector>
+#include <type_traits>
+#include <utility> // move, forward
 
 #include "../cpu.hpp" // cacheline_size
+#include "../macros.hpp" // NO_UNIQUE_ADDRESS
+#include "auxiliary/event_count.hpp"
+#include "auxiliary/queue_stats.hpp"
 
 template <typename T, typename Tag>
 struct TaggedData {
@@ -42,7 +47,12 @@ public:
     BMPMCQ_Writer(Q & ref) : q{ref} { q.writers.fetch_add(1); }
 
     bool try_push(value_type const& data) { return q.try_push(data); }
-    void push(value_type const& data) { q.push(data); }
+    bool try_push(value_type && data) { return q.try_push(std::move(data)); }
+    bool push(value_type const& data) { return q.push(data); }
+    bool push(value_type && data) { return q.push(std::move(data)); }
+
+    template <typename... Args>
+    bool try_emplace(Args&&... args) { return q.try_emplace(std::forward<Args>(args)...); }
 
     ~BMPMCQ_Writer() { if (q.writers.fetch_sub(1) == 1) q.close(); }
 
@@ -59,6 +69,7 @@ public:
     BMPMCQ_Reader(Q & ref) : q{ref} { }
 
     bool try_pop(value_type & data) { return q.try_pop(data); }
+    bool pop(value_type & data) { return q.pop(data); }
 
     explicit operator bool () const { return bool(q); }
 
@@ -66,10 +77,12 @@ private:
     Q & q;
 };
 
-template <typename T, size_t N>
+template <typename T, size_t N, class Backoff=core::spin_backoff, class Stats=core::no_stats>
 class B_MPMC_Queue {
 public:
     using value_type = T;
+    using backoff_type = Backoff;
+    using stats_type = Stats;
 
     B_MPMC_Queue() {
         for (size_t i : core::range(N)) {
@@ -85,38 +98,56 @@ public:
         return {*this};
     }
 
+    // Nothing may throw in between claiming a slot and publishing (push) or releasing (pop) it: the slot would be lost, wedging the ring.
+    // Copies and emplaced values are built before the claim, so only an assignment into / out of the slot happens after it;
+    // that one can't throw for a nothrow-move-assignable T (nothrow_slots). Other T-s still work, with that assignment as a risk.
+    static constexpr bool nothrow_slots = std::is_nothrow_move_assignable<T>::value;
+
     bool try_push(T const& data) {
-        auto index = write_to.load(std::memory_order_relaxed);
+        if constexpr (nothrow_slots && !std::is_nothrow_copy_assignable<T>::value) {
+            T copy (data); // may throw, nothing claimed yet
+            return try_push(std::move(copy));
+        } else {
+            return try_push_with([&](T & dst){ dst = data; });
+        }
+    }
 
-        for (;;) {
-            auto& slot = ring[index % N];
-            auto tag = slot.tag.load(std::memory_order_acquire);
+    // the argument is moved from only if the push succeeded
+    bool try_push(T && data) {
+        return try_push_with([&](T & dst){ dst = std::move(data); });
+    }
 
-            if ( tag == index ) { // empty & epoch matches
-                // try to CAS write_to <- write_to + 1
-                if ( write_to.compare_exchange_weak(index, index+1, std::memory_order_relaxed) ) {
-                    slot.data = data;
-                    slot.tag.store(index+1, std::memory_order_release);
-                    return true;
-                }
-            }
-            else if ( tag < index ) { // Full -- that's our own tail...
-                return false;
-            }
-            else {
-                index = write_to.load(std::memory_order_relaxed);
-            }
-        } 
+    // builds the value before claiming a slot, then move-assigns it in
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        T value (std::forward<Args>(args)...);
+        return try_push(std::move(value));
     }
 
-    void push(T const& data) {
-        constexpr size_t n_spinwaits = 1000;
-        // std::cerr << "push...\n";
-        for (;;) {
-            // std::cerr << ".";
-            for (size_t _ : core::range(n_spinwaits)) { if (try_push(data)) return; }
-            std::this_thread::yield();
-        }
+    // blocking push: false if the queue got closed before the element could be pushed
+    bool push(T const& data) {
+        return core::blocking_wait<Backoff>(not_full, 
+            [&]{ return try_push(data); }, 
+            [&]{ return closed(); },
+            stats
+        );
+    }
+
+    bool push(T && data) {
+        return core::blocking_wait<Backoff>(not_full, 
+            [&]{ return try_push(std::move(data)); }, 
+            [&]{ return closed(); },
+            stats
+        );
+    }
+
+    // blocking pop: false if the queue is closed and drained
+    bool pop(T & data) {
+        return core::blocking_wait<Backoff>(not_empty, 
+            [&]{ return try_pop(data); }, 
+            [&]{ return !bool(*this); },
+            stats
+        );
     }
 
     bool try_pop(T & data) {
@@ -128,12 +159,16 @@ public:
 
             if ( tag == index+1 ) { // filled & epoch matches
                 if ( read_from.compare_exchange_weak(index, index+1, std::memory_order_relaxed) ) {
-                    data = slot.data;
+                    data = std::move(slot.data);
                     slot.tag.store(index + N, std::memory_order_release);
+                    stats.popped();
+                    notify(not_full);
                     return true;
                 }
+                stats.cas_failed();
             }
             else if ( tag < index+1 ) { // empty
+                stats.pop_failed();
                 return false;
             }
             else {
@@ -142,18 +177,57 @@ public:
         }
     }
 
-    void close() { active.store(false); }
-    bool closed() const { return active.load(); }
+    void close() { 
+        active.store(false); 
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+    bool closed() const { return !active.load(); }
     
     explicit operator bool () const {
         return active || (write_to.load() != read_from.load());
     }
 
+    // see queue_stats.hpp: counters().snapshot()
+    Stats const& counters() const { return stats; }
+
     void print_state() const {
         std::cerr << "Q: [" << read_from.load() << " -> " << write_to.load() << "] | active: " << std::boolalpha << active.load() << "\n";
     }
 
 private:
+    // claims the back slot, lets `write` fill it in and publishes it
+    template <typename Write>
+    bool try_push_with(Write && write) {
+        auto index = write_to.load(std::memory_order_relaxed);
+
+        for (;;) {
+            auto& slot = ring[index % N];
+            auto tag = slot.tag.load(std::memory_order_acquire);
+
+            if ( tag == index ) { // empty & epoch matches
+                // try to CAS write_to <- write_to + 1
+                if ( write_to.compare_exchange_weak(index, index+1, std::memory_order_relaxed) ) {
+                    write(slot.data);
+                    slot.tag.store(index+1, std::memory_order_release);
+                    stats.pushed();
+                    notify(not_empty);
+                    return true;
+                }
+                stats.cas_failed();
+            }
+            else if ( tag < index ) { // Full -- that's our own tail...
+                stats.push_failed();
+                return false;
+            }
+            else {
+                index = write_to.load(std::memory_order_relaxed);
+            }
+        } 
+    }
+
+    void notify(core::event_count & ec) { if constexpr (Backoff::parks) ec.notify_one(); }
+
     std::atomic<int> write_to {0};
 
     std::vector<TaggedData<T, std::atomic<int>>> ring {N};
@@ -163,6 +237,10 @@ private:
     
     alignas(core::device::CPU::cacheline_size)
         std::atomic<bool> active {true};
+    core::event_count not_empty; // consumers park here
+    core::event_count not_full;  // producers park here
+
+    NO_UNIQUE_ADDRESS Stats stats;
 
 public:
     std::atomic<unsigned> writers {0};
@@ -9,11 +9,12 @@
 
 #include "../cpu.hpp" // cacheline_size
 #include "auxiliary/tagged.hpp"
-#include "io_descriptors.hpp"
+#include "queue/io_descriptors.hpp"
+#include "auxiliary/backoff.hpp" // backoff policies
 #include "../ints.hpp"
 
 
-template <typename T, size_t N, typename tag_type=unsigned>
+template <typename T, size_t N, typename tag_type=unsigned, class Backoff=core::spin_backoff>
 class B_MPMC_Queue {
     static_assert(std::is_unsigned<tag_type>::value, "tag_type should be unsigned!");
 
@@ -21,6 +22,7 @@ class B_MPMC_Queue {
     friend core::queue_writer<B_MPMC_Queue>;
 public:
     using value_type = T;
+    using backoff_type = Backoff;
     static constexpr size_t max_writers = -1;
     static constexpr size_t max_readers = -1;
 
@@ -57,13 +59,7 @@ public:
     }
 
     void push(T const& data) {
-        constexpr size_t n_spinwaits = 100000;
-        // std::cerr << "push...\n";
-        for (;;) {
-            // std::cerr << ".";
-            for (size_t _ : core::range(n_spinwaits)) { if (try_push(data)) return; }
-            std::this_thread::yield();
-        }
+        core::spin_wait<Backoff>([&]{ return try_push(data); });
     }
 
     bool try_pop(T & data) {
@@ -4,6 +4,7 @@
 #include "../cpu.hpp" // cacheline_size
 #include "../range.hpp" 
 #include "auxiliary/tagged.hpp" // TaggedData 
+#include "auxiliary/event_count.hpp" // event_count, blocking_wait, backoff policies
 #include "../ints.hpp"
 
 #include <vector>
@@ -46,6 +47,7 @@ public:
             data = slot.data;
             use_cached = false;
             slot.tag.store(stamp+1, std::memory_order_release);
+            q.notify(q.not_full);
             return true;
         }   
 
@@ -53,6 +55,14 @@ public:
         use_cached = true;
         return false;
     }
+
+    // blocking pop: false if the queue is closed and drained
+    bool pop(value_type & data) {
+        return core::blocking_wait<typename Queue::backoff_type>(q.not_empty, 
+            [&]{ return try_pop(data); }, 
+            [&]{ return empty(); }
+        );
+    }
    
 
     bool empty() const noexcept {
@@ -102,6 +112,7 @@ public:
                 slot.data = data;
                 use_cached = false;
                 slot.tag.store( stamp+1, std::memory_order_release ); // mark as written
+                q.notify(q.not_empty);
                 return true;
         }
         cached_write_index = index;
@@ -109,14 +120,12 @@ public:
         return false;
     }
 
-    void push(value_type const& data) {
-        static thread_local size_t n_spinwaits = 10 * (std::hash<std::thread::id>{}(std::this_thread::get_id()) % 100);
-        // Try using exponential backoff?
-        for (;;) {
-            // std::cerr << ".";
-            for (size_t _ : core::range(n_spinwaits)) { if (try_push(data)) return; }
-            std::this_thread::yield();
-        }
+    // blocking push: false if the queue got closed before the element could be pushed
+    bool push(value_type const& data) {
+        return core::blocking_wait<typename Queue::backoff_type>(q.not_full, 
+            [&]{ return try_push(data); }, 
+            [&]{ return q.closed(); }
+        );
     }
 
 private:
@@ -126,12 +135,13 @@ private:
 };
 
 
-template <typename T>
+template <typename T, class Backoff=core::spin_backoff>
 class mpmc_queue {
     friend queue_reader<mpmc_queue>;
     friend queue_writer<mpmc_queue>;
 public:
     using value_type = T;
+    using backoff_type = Backoff;
 
     mpmc_queue(size_t size=2048) : ring(size) {
         for (auto& elem : ring) {
@@ -150,7 +160,11 @@ public:
     }
 
     
-    void close() noexcept { active.store(false, std::memory_order_release); }
+    void close() noexcept { 
+        active.store(false, std::memory_order_release); 
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
 
     bool closed() const noexcept { return !active.load(std::memory_order_acquire); }
 
@@ -178,7 +192,9 @@ public:
     }
 
 private:
-    std::vector< TaggedData<T, std::atomic<unsigned>> > ring;
+    void notify(core::event_count & ec) { if constexpr (Backoff::parks) ec.notify_one(); }
+
+    std::vector< core::TaggedData<T, std::atomic<unsigned>> > ring;
 
     alignas(core::device::CPU::cacheline_size) 
     std::atomic<size_t> read_from {0};
@@ -188,6 +204,8 @@ private:
 
     alignas(core::device::CPU::cacheline_size) 
     std::atomic<bool> active {true};
+    core::event_count not_empty; // readers park here
+    core::event_count not_full;  // writers park here
 
     std::atomic<size_t> n_writers {0};
     std::atomic<size_t> n_readers {0};
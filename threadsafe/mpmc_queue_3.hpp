@@ -4,6 +4,7 @@
 #include "../cpu.hpp" // cacheline_size
 #include "../range.hpp" 
 #include "auxiliary/tagged.hpp" // TaggedData 
+#include "auxiliary/backoff.hpp" // backoff policies 
 #include "../ints.hpp"
 
 #include <vector>
@@ -15,7 +16,7 @@ enum class tag_status : core::u8 {
 };
 
 
-template <typename T>
+template <typename T, class Backoff=core::spin_backoff>
 class mpmc_queue {
 public:
     mpmc_queue(size_t size=2048) : ring(size) {
@@ -47,13 +48,7 @@ public:
     }
 
     void push(T const& data) {
-        constexpr size_t n_spinwaits = 100000;
-        // Try using exponential backoff?
-        for (;;) {
-            // std::cerr << ".";
-            for (size_t _ : core::range(n_spinwaits)) { if (try_push(data)) return; }
-            std::this_thread::yield();
-        }
+        core::spin_wait<Backoff>([&]{ return try_push(data); });
     }
 
     bool try_pop(T & data) {
@@ -113,7 +108,7 @@ public:
     }
 
 private:
-    std::vector< TaggedData<T, std::atomic<tag_status>> > ring;
+    std::vector< core::TaggedData<T, std::atomic<tag_status>> > ring;
 
     alignas(core::device::CPU::cacheline_size) 
     std::atomic<size_t> read_from {0};
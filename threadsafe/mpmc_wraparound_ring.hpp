@@ -4,6 +4,7 @@
 #include "../cpu.hpp" // cacheline_size
 #include "../range.hpp" 
 #include "auxiliary/tagged.hpp" // TaggedData 
+#include "auxiliary/backoff.hpp" // backoff policies 
 #include "../ints.hpp"
 
 #include <vector>
@@ -135,13 +136,7 @@ public:
     }
 
     void push(value_type const& data) {
-        constexpr size_t n_spinwaits = 100000;
-        // Try using exponential backoff?
-        for (;;) {
-            // std::cerr << ".";
-            for (size_t _ : core::range(n_spinwaits)) { if (try_push(data)) return; }
-            std::this_thread::yield();
-        }
+        core::spin_wait<typename Queue::backoff_type>([&]{ return try_push(data); });
     }
 
 private:
@@ -151,12 +146,13 @@ private:
 };
 
 
-template <typename T>
+template <typename T, class Backoff=core::spin_backoff>
 class mpmc_queue {
     friend queue_reader<mpmc_queue>;
     friend queue_writer<mpmc_queue>;
 public:
     using value_type = T;
+    using backoff_type = Backoff;
 
     mpmc_queue(size_t size=2048) : ring(size) {
         for (auto& elem : ring) {
@@ -210,7 +206,7 @@ public:
     }
 
 private:
-    std::vector< TaggedData<T, std::atomic<tag_status>> > ring;
+    std::vector< core::TaggedData<T, std::atomic<tag_status>> > ring;
 
     alignas(core::device::CPU::cacheline_size) 
     std::atomic<size_t> read_from {0};
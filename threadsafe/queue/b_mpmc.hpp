@@ -6,21 +6,41 @@
 #include <atomic>
 #include <vector>
 #include <type_traits>
+#include <utility> // move, forward
 
 #include "../../cpu.hpp" // cacheline_size
 #include "../../ints.hpp"
+#include "../../bits.hpp" // is_pow2, log2
+#include "../../macros.hpp" // NO_UNIQUE_ADDRESS
 #include "../auxiliary/tagged.hpp"
+#include "../auxiliary/slot_ref.hpp"
+#include "../auxiliary/slot_layout.hpp"
+#include "../auxiliary/event_count.hpp"
+#include "../auxiliary/queue_stats.hpp"
 #include "io_descriptors.hpp"
 
 
-template <typename T, size_t N, typename tag_type=unsigned>
+template <typename T, size_t N, typename tag_type=unsigned, class Backoff=core::spin_backoff, class Layout=core::slot_layout::dense, class Stats=core::no_stats>
 class bounded_mpmc {
     static_assert(std::is_unsigned<tag_type>::value, "tag_type should be unsigned!");
+    // a power-of-two N turns index % N and index / N into a mask and a shift
+    // and keeps 2*epoch continuous (mod 2^bits(tag_type)) when the index wraps around
+    static_assert(core::is_pow2(N), "N should be a power of two!");
+    static_assert(core::log2(N) + 8*sizeof(tag_type) <= 8*sizeof(size_t), "tag_type is too wide for this N!");
+
+    static constexpr size_t mask = N - 1;
+    static constexpr unsigned shift = core::log2(N);
+
+    // slot type & index -> slot mapping, see slot_layout.hpp
+    using layout = typename Layout::template bind<core::TaggedData<T, std::atomic<tag_type>>, N>;
 
     friend core::queue_reader<bounded_mpmc>;
     friend core::queue_writer<bounded_mpmc>;
 public:
     using value_type = T;
+    using backoff_type = Backoff;
+    using layout_type = Layout;
+    using stats_type = Stats;
     static constexpr size_t max_writers = -1;
     static constexpr size_t max_readers = -1;
 
@@ -39,70 +59,191 @@ public:
     }
 
 
+    // Nothing may throw in between claiming a slot and publishing (push) or releasing (pop) it: the slot would be lost, wedging the ring.
+    // Copies and emplaced values are built before the claim, so only an assignment into / out of the slot happens after it;
+    // that one can't throw for a nothrow-move-assignable T (nothrow_slots). Other T-s still work, with that assignment as a risk.
+    static constexpr bool nothrow_slots = std::is_nothrow_move_assignable<T>::value;
+
     bool try_push(T const& data) {
-        auto index = write_to.load(std::memory_order_acquire);//relaxed);
+        if constexpr (nothrow_slots && !std::is_nothrow_copy_assignable<T>::value) {
+            T copy (data); // may throw, nothing claimed yet
+            return try_push(std::move(copy));
+        } else {
+            return try_push_with([&](T & dst){ dst = data; });
+        }
+    }
 
-        auto& slot = ring[index % N];
-        auto tag = slot.tag.load(std::memory_order_acquire);
+    // the argument is moved from only if the push succeeded
+    bool try_push(T && data) {
+        return try_push_with([&](T & dst){ dst = std::move(data); });
+    }
 
-        auto epoch = tag_type( index/N );
-        if ( tag % 2 == 0 && tag == tag_type(2*epoch) ) { // empty 
-            if ( write_to.compare_exchange_weak(index, index+1, std::memory_order_relaxed) ) {
-                slot.data = data;
-                slot.tag.store(tag+1, std::memory_order_release);
-                return true;
-                // return slot.tag.compare_exchange_weak(tag, tag+1, std::memory_order_acq_rel);
-            }
-        }
-        
-        return false;
+    // builds the value before claiming a slot, then move-assigns it in
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        T value (std::forward<Args>(args)...);
+        return try_push(std::move(value));
     }
 
-    void push(T const& data) {
-        constexpr size_t n_spinwaits = 1;//100000;
-        // std::cerr << "push...\n";
-        for (;;) {
-            // std::cerr << ".";
-            for (size_t _ : core::range(n_spinwaits)) { if (try_push(data)) return; }
-            std::this_thread::yield();
-        }
+    // blocking push: false if the queue got closed before the element could be pushed
+    bool push(T const& data) {
+        return core::blocking_wait<Backoff>(not_full, 
+            [&]{ return try_push(data); }, 
+            [&]{ return closed(); },
+            stats
+        );
+    }
+
+    bool push(T && data) {
+        return core::blocking_wait<Backoff>(not_full, 
+            [&]{ return try_push(std::move(data)); }, 
+            [&]{ return closed(); },
+            stats
+        );
+    }
+
+    // blocking pop: false if the queue is closed and drained
+    bool pop(T & data) {
+        return core::blocking_wait<Backoff>(not_empty, 
+            [&]{ return try_pop(data); }, 
+            [&]{ return !bool(*this); },
+            stats
+        );
     }
 
     bool try_pop(T & data) {
         auto index = read_from.load(std::memory_order_acquire);//relaxed);
 
-        auto& slot = ring[index % N];
+        auto& slot = slot_at(index);
         auto tag = slot.tag.load(std::memory_order_acquire);
 
-        auto epoch = tag_type( index / N );
+        auto epoch = tag_type( index >> shift );
         if ( tag % 2 != 0 && (tag_type(2*epoch) == (tag-1)) ) {
             if ( read_from.compare_exchange_weak(index, index+1, std::memory_order_relaxed) ) {
                 data = std::move(slot.data);
                 slot.tag.store(tag+1, std::memory_order_release);
+                stats.popped();
+                notify(not_full);
                 return true;
                 // return slot.tag.compare_exchange_weak(tag, tag+1, std::memory_order_acq_rel);
             }
+            stats.cas_failed();
         }
 
+        stats.pop_failed();
         return false;
 
     }
 
-    void close() { active.store(false, std::memory_order_release); }
-    bool closed() const { return active.load(std::memory_order_acquire); }
+    /**
+     * @brief zero-copy push: claims a slot to be written in-place (empty handle if the queue is full),
+     *        consumers won't see the slot until it's commit()-ed
+     */
+    core::slot_ref<T> reserve() {
+        auto index = write_to.load(std::memory_order_acquire);
+
+        auto& slot = slot_at(index);
+        auto tag = slot.tag.load(std::memory_order_acquire);
+
+        auto epoch = tag_type( index >> shift );
+        if ( tag % 2 == 0 && tag == tag_type(2*epoch) ) { // empty 
+            if ( write_to.compare_exchange_weak(index, index+1, std::memory_order_relaxed) ) {
+                stats.pushed();
+                return {&slot.data, index};
+            }
+            stats.cas_failed();
+        }
+        stats.push_failed();
+        return {};
+    }
+
+    void commit(core::slot_ref<T> const& slot) {
+        auto epoch = tag_type( slot.index >> shift );
+        slot_at(slot.index).tag.store(tag_type(2*epoch) + 1, std::memory_order_release);
+        notify(not_empty);
+    }
+
+    /**
+     * @brief zero-copy pop: claims the front slot to be read in-place (empty handle if there's none),
+     *        the slot is handed back to producers by release()
+     */
+    core::slot_ref<T> peek() {
+        auto index = read_from.load(std::memory_order_acquire);
+
+        auto& slot = slot_at(index);
+        auto tag = slot.tag.load(std::memory_order_acquire);
+
+        auto epoch = tag_type( index >> shift );
+        if ( tag % 2 != 0 && (tag_type(2*epoch) == (tag-1)) ) {
+            if ( read_from.compare_exchange_weak(index, index+1, std::memory_order_relaxed) ) {
+                stats.popped();
+                return {&slot.data, index};
+            }
+            stats.cas_failed();
+        }
+        stats.pop_failed();
+        return {};
+    }
+
+    void release(core::slot_ref<T> const& slot) {
+        auto epoch = tag_type( slot.index >> shift );
+        slot_at(slot.index).tag.store(tag_type(2*epoch) + 2, std::memory_order_release);
+        notify(not_full);
+    }
+
+    void close() { 
+        active.store(false, std::memory_order_release); 
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+    bool closed() const { return !active.load(std::memory_order_acquire); }
+    bool empty() const { return write_to.load(std::memory_order_acquire) == read_from.load(std::memory_order_acquire); }
 
     explicit operator bool () const {
         return active.load(std::memory_order_acquire) || (write_to.load(std::memory_order_acquire) != read_from.load(std::memory_order_acquire));
     }
 
 
+    // see queue_stats.hpp: counters().snapshot()
+    Stats const& counters() const { return stats; }
+
+
     void print_state() const {
         std::cerr << "Q: [" << read_from.load() << " -> " << write_to.load() << "] | active: " << std::boolalpha << active.load() << "\n";
         std::cerr << "readers: " << n_readers << "; writers: " << n_writers << "\n";
     }
 
 private:
-    std::vector<core::TaggedData<T, std::atomic<tag_type>>> ring {N};
+    // claims the back slot, lets `write` fill it in and publishes it
+    template <typename Write>
+    bool try_push_with(Write && write) {
+        auto index = write_to.load(std::memory_order_acquire);//relaxed);
+
+        auto& slot = slot_at(index);
+        auto tag = slot.tag.load(std::memory_order_acquire);
+
+        auto epoch = tag_type( index >> shift );
+        if ( tag % 2 == 0 && tag == tag_type(2*epoch) ) { // empty
+            if ( write_to.compare_exchange_weak(index, index+1, std::memory_order_relaxed) ) {
+                write(slot.data);
+                slot.tag.store(tag+1, std::memory_order_release);
+                stats.pushed();
+                notify(not_empty);
+                return true;
+                // return slot.tag.compare_exchange_weak(tag, tag+1, std::memory_order_acq_rel);
+            }
+            stats.cas_failed();
+        }
+
+        stats.push_failed();
+        return false;
+    }
+
+    void notify(core::event_count & ec) { if constexpr (Backoff::parks) ec.notify_one(); }
+
+    typename layout::slot_type & slot_at(size_t index) { return ring[layout::map(index & mask)]; }
+
+    std::vector<typename layout::slot_type> ring {N};
     
     alignas(core::device::CPU::cacheline_size)
     std::atomic<size_t> write_to {0};
@@ -112,10 +253,14 @@ private:
     
     alignas(core::device::CPU::cacheline_size)
         std::atomic<bool> active {true};
+    core::event_count not_empty; // consumers park here
+    core::event_count not_full;  // producers park here
 
     alignas(core::device::CPU::cacheline_size)
     std::atomic<unsigned> n_readers{0};
 
     alignas(core::device::CPU::cacheline_size)
     std::atomic<unsigned> n_writers{0};
+
+    NO_UNIQUE_ADDRESS Stats stats;
 };
\ No newline at end of file
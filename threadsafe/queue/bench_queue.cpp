@@ -0,0 +1,427 @@
+//! Queue benchmark: queue type x capacity x producers / consumers x payload size
+//!
+//! Every producer pushes its share of --items elements through the queue's writer descriptor, the consumers pop them with
+//! the blocking pop until the queue gets closed by the last writer and drained. A run reports
+//!  - throughput: items / wall time from the start signal until the last consumer is done (median over --repeat runs),
+//!  - latency: enqueue -> dequeue time of every --sample'th element (percentiles over all the runs), in ns.
+//! Results go to stdout as an aligned table, CSV or JSON (--format), e.g.
+//!     ./bench_queue --queues=bounded_mpmc,sharded_queue --producers=1,4 --consumers=1,4 --format=csv > results.csv
+//! Build: g++ -std=c++17 -O2 -pthread bench_queue.cpp -o bench_queue
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <utility> // index_sequence
+#include <cstdlib>
+#include "../../thread.hpp"
+#include "../../range.hpp"
+#include "../../ints.hpp"
+
+#include "spsc_queue.hpp"
+#include "cached_spsc_queue.hpp"
+#include "unbounded_spsc_queue.hpp"
+#include "b_mpmc.hpp"
+#include "sharded_queue.hpp"
+#include "unbounded_mpmc.hpp"
+#include "mutex_queue.hpp"
+#include "../bounded_mpmc.hpp"
+
+
+using bench_clock = std::chrono::steady_clock;
+
+static core::u64 now_ns() {
+    return core::u64(std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now().time_since_epoch()).count());
+}
+
+// named bench threads, pinned to cpu (mod the number of cpus) with --pin
+static core::thread_options bench_thread(std::string name, unsigned cpu, bool pin) {
+    core::thread_options options;
+    options.named(std::move(name));
+    if ( pin ) options.pin(cpu % core::thread::hardware_concurrency());
+    return options;
+}
+
+
+// ===== payloads =====
+
+template <size_t Bytes>
+struct padding { char pad[Bytes]; };
+
+template <>
+struct padding<0> {};
+
+template <size_t Bytes>
+struct payload : padding<Bytes - 2 * sizeof(core::u64)> {
+    static_assert(Bytes >= 2 * sizeof(core::u64), "a payload carries a sequence number and a timestamp");
+    core::u64 seq;
+    core::u64 stamp; // enqueue time in ns, 0 if the element isn't sampled
+};
+
+using payload_sizes = std::index_sequence<16, 64, 256>;
+using capacities    = std::index_sequence<64, 1024, 16384>;
+
+
+// ===== queues =====
+
+// SimpleQueue behind the reader() / writer() descriptors the other queues have
+template <typename T>
+class locked_queue {
+public:
+    using value_type = T;
+
+    locked_queue(size_t capacity) : q{capacity} {}
+
+    struct writer_type {
+        writer_type(locked_queue & ref) : ref{ref} { ref.n_writers.fetch_add(1); }
+        ~writer_type() { if (ref.n_writers.fetch_sub(1) == 1) ref.q.close(); }
+        bool push(T const& v) { ref.q.push(v); return true; }
+        locked_queue & ref;
+    };
+
+    struct reader_type {
+        bool pop(T & v) { return ref.q.pop(v); }
+        locked_queue & ref;
+    };
+
+    writer_type writer() { return {*this}; }
+    reader_type reader() { return {*this}; }
+
+private:
+    SimpleQueue<T> q;
+    std::atomic<unsigned> n_writers {0};
+};
+
+
+// name, single producer / consumer only, capacity-bounded, make<T, capacity>()
+#define BENCH_TARGET(NAME, SINGLE, BOUNDED, ...) \
+    struct NAME { \
+        static constexpr const char* name = #NAME; \
+        static constexpr bool single = SINGLE; \
+        static constexpr bool bounded = BOUNDED; \
+        template <typename T, size_t Cap> static auto make() { return __VA_ARGS__; } \
+    }
+
+namespace targets {
+    BENCH_TARGET(spsc_queue,           true,  true,  std::make_unique<::spsc_queue<T>>(Cap));
+    BENCH_TARGET(cached_spsc_queue,    true,  true,  std::make_unique<::cached_spsc_queue<T>>(Cap));
+    BENCH_TARGET(unbounded_spsc_queue, true,  false, std::make_unique<::unbounded_spsc_queue<T>>());
+    BENCH_TARGET(bounded_mpmc,         false, true,  std::make_unique<::bounded_mpmc<T, Cap>>());
+    BENCH_TARGET(B_MPMC_Queue,         false, true,  std::make_unique<::B_MPMC_Queue<T, Cap>>());
+    BENCH_TARGET(sharded_queue,        false, true,  std::make_unique<::sharded_queue<T, Cap>>());
+    BENCH_TARGET(unbounded_mpmc,       false, false, std::make_unique<::unbounded_mpmc<T>>());
+    BENCH_TARGET(mutex_queue,          false, false, std::make_unique<locked_queue<T>>(Cap));
+
+    using all = std::tuple<spsc_queue, cached_spsc_queue, unbounded_spsc_queue,
+                           bounded_mpmc, B_MPMC_Queue, sharded_queue, unbounded_mpmc, mutex_queue>;
+}
+
+#undef BENCH_TARGET
+
+
+// ===== the run =====
+
+struct config {
+    std::vector<std::string> queues;
+    std::vector<size_t> capacity {1024};
+    std::vector<size_t> producers {1, 2, 4};
+    std::vector<size_t> consumers {1, 2, 4};
+    std::vector<size_t> payload {16};
+    size_t items = 1'000'000;
+    size_t repeat = 3;
+    size_t sample = 64;
+    bool pin = false;
+    std::string format = "table";
+};
+
+struct result {
+    std::string queue;
+    size_t capacity, producers, consumers, payload, items;
+    double mops, mops_min, mops_max; // median / min / max over the runs
+    core::u64 p50, p90, p99, p999, max; // ns
+    bool ok;
+};
+
+
+template <class Target, typename P, size_t Cap>
+result run(config const& cfg, size_t n_producers, size_t n_consumers) {
+    std::vector<double> throughput;
+    std::vector<core::u64> latencies;
+    bool ok = true;
+
+    const size_t per_producer = cfg.items / n_producers;
+    const size_t total = per_producer * n_producers;
+
+    for (size_t r : core::range(cfg.repeat)) {
+        (void)r;
+        auto q = Target::template make<P, Cap>();
+
+        std::atomic<size_t> ready {0};
+        std::atomic<bool> go {false};
+        std::atomic<core::u64> sum {0};
+        std::vector<std::vector<core::u64>> samples (n_consumers);
+        bench_clock::time_point start;
+
+        auto wait_for_start = [&] {
+            ready.fetch_add(1);
+            while ( !go.load(std::memory_order_acquire) ) std::this_thread::yield();
+        };
+
+        {// threads
+            std::vector<core::thread> threads;
+            threads.reserve(n_producers + n_consumers);
+            unsigned cpu = 0;
+
+            for (size_t c : core::range(n_consumers)) {
+                threads.emplace_back( bench_thread("consumer-" + std::to_string(c), cpu, cfg.pin), [&, c] {
+                    auto reader = q->reader();
+                    auto & lat = samples[c];
+                    lat.reserve(total / cfg.sample / n_consumers + 16);
+                    wait_for_start();
+
+                    P v;
+                    core::u64 s = 0;
+                    while ( reader.pop(v) ) {
+                        s += v.seq;
+                        if ( v.stamp ) lat.push_back(now_ns() - v.stamp);
+                    }
+                    sum.fetch_add(s);
+                });
+                ++cpu;
+            }
+
+            for (size_t p : core::range(n_producers)) {
+                threads.emplace_back( bench_thread("producer-" + std::to_string(p), cpu, cfg.pin), [&, p] {
+                    auto writer = q->writer();
+                    wait_for_start();
+
+                    P v {};
+                    for (size_t i : core::range(per_producer)) {
+                        v.seq = p * per_producer + i + 1;
+                        v.stamp = (i % cfg.sample == 0) ? now_ns() : 0;
+                        writer.push(v);
+                    }
+                });
+                ++cpu;
+            }
+
+            while ( ready.load() != n_producers + n_consumers ) std::this_thread::yield();
+            start = bench_clock::now();
+            go.store(true, std::memory_order_release);
+        }// threads join
+
+        const double seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+        throughput.push_back(double(total) / seconds / 1e6);
+        ok = ok && sum.load() == core::u64(total) * (total + 1) / 2;
+        for (auto & lat : samples) latencies.insert(latencies.end(), lat.begin(), lat.end());
+    }
+
+    std::sort(throughput.begin(), throughput.end());
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) -> core::u64 {
+        if ( latencies.empty() ) return 0;
+        return latencies[std::min(latencies.size() - 1, size_t(p * double(latencies.size())))];
+    };
+
+    return {
+        Target::name, Target::bounded ? Cap : 0, n_producers, n_consumers, sizeof(P), total,
+        throughput[throughput.size() / 2], throughput.front(), throughput.back(),
+        percentile(0.50), percentile(0.90), percentile(0.99), percentile(0.999),
+        latencies.empty() ? 0 : latencies.back(),
+        ok
+    };
+}
+
+
+// ===== runtime -> compile-time dispatch =====
+
+template <typename F, size_t... Sizes>
+bool with_payload(size_t bytes, F && f, std::index_sequence<Sizes...>) {
+    return ( (bytes == Sizes && (f(payload<Sizes>{}), true)) || ... );
+}
+
+template <typename F, size_t... Caps>
+bool with_capacity(size_t cap, F && f, std::index_sequence<Caps...>) {
+    return ( (cap == Caps && (f(std::integral_constant<size_t, Caps>{}), true)) || ... );
+}
+
+template <typename F, typename... Targets>
+bool with_target(std::string const& name, F && f, std::tuple<Targets...>*) {
+    return ( (name == Targets::name && (f(Targets{}), true)) || ... );
+}
+
+template <typename... Targets>
+std::vector<std::string> target_names(std::tuple<Targets...>*) { return {Targets::name...}; }
+
+template <size_t... I>
+std::string list(std::index_sequence<I...>) {
+    std::string s;
+    ((s += (s.empty() ? "" : ",") + std::to_string(I)), ...);
+    return s;
+}
+
+
+// ===== output =====
+
+void print_header(config const& cfg) {
+    if ( cfg.format == "csv" ) {
+        std::cout << "queue,capacity,producers,consumers,payload,items,mops,mops_min,mops_max,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,ok\n";
+    }
+    else if ( cfg.format == "json" ) {
+        std::cout << "{\n  \"hardware_concurrency\": " << core::thread::hardware_concurrency()
+                  << ",\n  \"repeat\": " << cfg.repeat << ",\n  \"sample\": " << cfg.sample
+                  << ",\n  \"pinned\": " << std::boolalpha << cfg.pin << ",\n  \"results\": [";
+    }
+    else {
+        std::cout << std::left << std::setw(22) << "queue" << std::right
+                  << std::setw(7) << "cap" << std::setw(4) << "P" << std::setw(4) << "C" << std::setw(6) << "bytes"
+                  << std::setw(10) << "Mops/s" << std::setw(17) << "[min, max]"
+                  << std::setw(9) << "p50" << std::setw(9) << "p90" << std::setw(9) << "p99" << std::setw(10) << "p99.9" << std::setw(11) << "max ns"
+                  << "\n";
+    }
+}
+
+void print_result(config const& cfg, result const& r, bool first) {
+    std::ostringstream mops;
+    mops << std::fixed << std::setprecision(2);
+    auto fixed = [&](double x) { mops.str(""); mops << x; return mops.str(); };
+
+    if ( cfg.format == "csv" ) {
+        std::cout << r.queue << ',' << r.capacity << ',' << r.producers << ',' << r.consumers << ',' << r.payload << ',' << r.items << ','
+                  << fixed(r.mops) << ',' << fixed(r.mops_min) << ',' << fixed(r.mops_max) << ','
+                  << r.p50 << ',' << r.p90 << ',' << r.p99 << ',' << r.p999 << ',' << r.max << ',' << r.ok << "\n";
+    }
+    else if ( cfg.format == "json" ) {
+        std::cout << (first ? "\n" : ",\n")
+                  << "    {\"queue\": \"" << r.queue << "\", \"capacity\": " << r.capacity
+                  << ", \"producers\": " << r.producers << ", \"consumers\": " << r.consumers
+                  << ", \"payload\": " << r.payload << ", \"items\": " << r.items
+                  << ", \"mops\": " << fixed(r.mops) << ", \"mops_min\": " << fixed(r.mops_min) << ", \"mops_max\": " << fixed(r.mops_max)
+                  << ", \"latency_ns\": {\"p50\": " << r.p50 << ", \"p90\": " << r.p90 << ", \"p99\": " << r.p99
+                  << ", \"p999\": " << r.p999 << ", \"max\": " << r.max << "}"
+                  << ", \"ok\": " << std::boolalpha << r.ok << "}";
+    }
+    else {
+        std::cout << std::left << std::setw(22) << r.queue << std::right
+                  << std::setw(7) << (r.capacity ? std::to_string(r.capacity) : "-")
+                  << std::setw(4) << r.producers << std::setw(4) << r.consumers << std::setw(6) << r.payload
+                  << std::setw(10) << fixed(r.mops) << std::setw(17) << ("[" + fixed(r.mops_min) + ", " + fixed(r.mops_max) + "]")
+                  << std::setw(9) << r.p50 << std::setw(9) << r.p90 << std::setw(9) << r.p99 << std::setw(10) << r.p999 << std::setw(11) << r.max
+                  << (r.ok ? "" : "  CHECKSUM MISMATCH") << "\n";
+    }
+    std::cout << std::flush;
+}
+
+void print_footer(config const& cfg) {
+    if ( cfg.format == "json" ) std::cout << "\n  ]\n}\n";
+}
+
+
+// ===== command line =====
+
+std::vector<std::string> split(std::string const& s) {
+    std::vector<std::string> parts;
+    std::istringstream in {s};
+    for (std::string part; std::getline(in, part, ','); ) if ( !part.empty() ) parts.push_back(part);
+    return parts;
+}
+
+std::vector<size_t> split_sizes(std::string const& s) {
+    std::vector<size_t> sizes;
+    for (auto & part : split(s)) sizes.push_back(std::stoull(part));
+    return sizes;
+}
+
+void usage(const char* self) {
+    std::cerr << "usage: " << self << " [options]\n"
+              << "  --queues=a,b,...     queue types (default: all): ";
+    for (auto & name : target_names((targets::all*)nullptr)) std::cerr << name << " ";
+    std::cerr << "\n"
+              << "  --capacity=64,...    capacities of the bounded queues, one of " << list(capacities{}) << " (default: 1024)\n"
+              << "  --producers=1,2,4    producer thread counts\n"
+              << "  --consumers=1,2,4    consumer thread counts (SPSC queues only run 1 x 1)\n"
+              << "  --payload=16,...     element sizes in bytes, one of " << list(payload_sizes{}) << " (default: 16)\n"
+              << "  --items=N            elements per run (default: 1000000)\n"
+              << "  --repeat=N           runs per configuration (default: 3)\n"
+              << "  --sample=N           time every N-th element for the latency percentiles (default: 64)\n"
+              << "  --pin                pin the threads to cpus 0, 1, ... (consumers first)\n"
+              << "  --format=table|csv|json\n";
+}
+
+bool parse(int argc, char** argv, config & cfg) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        auto key = arg.substr(0, eq);
+        auto value = eq == std::string::npos ? std::string{} : arg.substr(eq + 1);
+
+        if      ( key == "--queues" )    cfg.queues = split(value);
+        else if ( key == "--capacity" )  cfg.capacity = split_sizes(value);
+        else if ( key == "--producers" ) cfg.producers = split_sizes(value);
+        else if ( key == "--consumers" ) cfg.consumers = split_sizes(value);
+        else if ( key == "--payload" )   cfg.payload = split_sizes(value);
+        else if ( key == "--items" )     cfg.items = std::stoull(value);
+        else if ( key == "--repeat" )    cfg.repeat = std::max<size_t>(1, std::stoull(value));
+        else if ( key == "--sample" )    cfg.sample = std::max<size_t>(1, std::stoull(value));
+        else if ( key == "--pin" )       cfg.pin = true;
+        else if ( key == "--format" )    cfg.format = value;
+        else return false;
+    }
+    if ( cfg.queues.empty() ) cfg.queues = target_names((targets::all*)nullptr);
+
+    // the capacities & payload sizes are template arguments: only the instantiated ones can run
+    for (size_t cap : cfg.capacity) if ( !with_capacity(cap, [](auto){}, capacities{}) ) return false;
+    for (size_t bytes : cfg.payload) if ( !with_payload(bytes, [](auto){}, payload_sizes{}) ) return false;
+    return cfg.format == "table" || cfg.format == "csv" || cfg.format == "json";
+}
+
+
+int main(int argc, char** argv) {
+    config cfg;
+    try {
+        if ( !parse(argc, argv, cfg) ) { usage(argv[0]); return 1; }
+    }
+    catch (std::exception const&) { usage(argv[0]); return 1; }
+
+    print_header(cfg);
+    bool first = true;
+    bool all_ok = true;
+
+    for (auto & name : cfg.queues) {
+        bool known = with_target(name, [&](auto target) {
+            using Target = decltype(target);
+
+            for (size_t cap : cfg.capacity) {
+                for (size_t bytes : cfg.payload) {
+                    for (size_t n_producers : cfg.producers) {
+                        for (size_t n_consumers : cfg.consumers) {
+                            if ( n_producers == 0 || n_consumers == 0 ) continue;
+                            if ( Target::single && (n_producers != 1 || n_consumers != 1) ) continue;
+
+                            with_capacity(cap, [&](auto C) {
+                                with_payload(bytes, [&](auto p) {
+                                    auto r = run<Target, decltype(p), decltype(C)::value>(cfg, n_producers, n_consumers);
+                                    all_ok = all_ok && r.ok;
+                                    print_result(cfg, r, first);
+                                    first = false;
+                                }, payload_sizes{});
+                            }, capacities{});
+                        }
+                    }
+                }
+                if ( !Target::bounded ) break; // capacity doesn't apply
+            }
+        }, (targets::all*)nullptr);
+
+        if ( !known ) std::cerr << "unknown queue: " << name << "\n";
+    }
+
+    print_footer(cfg);
+    return all_ok ? 0 : 2;
+}
@@ -0,0 +1,260 @@
+// Disruptor-style broadcast ring: a single producer, any number of readers, each of which sees every message.
+// Every reader has a sequence cursor of its own (on a cacheline of its own), the producer either
+//  - broadcast_mode::blocking:  waits for the slowest reader before reusing a slot, or
+//  - broadcast_mode::overwrite: never waits, slots are seqlock-ed and a reader that has been lapped by the producer
+//                               notices it, skips to the oldest message still in the ring and counts the missed ones.
+// Readers join at the current end of the stream: they see the messages pushed after they've been created.
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <type_traits>
+#include <exception>
+#include <stdexcept> // length_error
+#include <iostream>
+#include "../../cpu.hpp" // cacheline_size
+#include "../../range.hpp"
+#include "../../bits.hpp" // ceil_pow2
+#include "../../ints.hpp"
+#include "../../macros.hpp" // NO_UNIQUE_ADDRESS
+#include "../auxiliary/tagged.hpp"
+#include "../auxiliary/event_count.hpp" // event_count, blocking_wait, backoff policies
+#include "../auxiliary/queue_stats.hpp"
+#include "io_descriptors.hpp" // core::queue_writer
+
+
+enum class broadcast_mode { blocking, overwrite };
+
+
+template <typename Q>
+class broadcast_reader {
+public:
+    using value_type = typename Q::value_type;
+
+    broadcast_reader(Q & ref) : q{ref}, id{q.subscribe()} {}
+    ~broadcast_reader() { q.unsubscribe(id); }
+
+    broadcast_reader(broadcast_reader const&) = delete;
+    broadcast_reader& operator= (broadcast_reader const&) = delete;
+
+    bool try_pop(value_type & data) { return q.try_pop(id, data, n_missed); }
+    bool pop(value_type & data) { return q.pop(id, data, n_missed); }
+
+    // messages overwritten before this reader got to them (overwrite mode)
+    core::u64 missed() const { return n_missed; }
+    // messages pushed but not read yet
+    core::u64 lag() const { return q.lag(id); }
+
+    explicit operator bool () const { return q.readable(id); }
+
+private:
+    Q & q;
+    size_t id;
+    core::u64 n_missed {0};
+};
+
+
+/**
+ * @brief single-producer multicast ring of (at least) `size` slots for up to `max_readers` readers at a time
+ * @remark the writer is a core::queue_writer (closes the ring when destroyed), readers are broadcast_reader-s;
+ *         Stats counts a pop per reader per message, so its occupancy histogram says nothing about a multicast ring
+ */
+template <typename T, broadcast_mode Mode = broadcast_mode::blocking, class Backoff = core::spin_backoff, class Stats = core::no_stats>
+class broadcast_ring {
+    // in the overwrite mode a reader may copy a slot while the producer is rewriting it (and then discard the copy)
+    static_assert(Mode != broadcast_mode::overwrite || std::is_trivially_copyable<T>::value,
+        "broadcast_mode::overwrite requires a trivially copyable T");
+
+    using seq_type = core::u64;
+    static constexpr seq_type unsubscribed = seq_type(-1);
+
+    struct alignas(core::device::CPU::cacheline_size) cursor {
+        std::atomic<seq_type> seq {unsubscribed};
+    };
+
+    friend core::queue_writer<broadcast_ring>;
+    friend broadcast_reader<broadcast_ring>;
+
+    struct too_many_readers : std::exception {};
+    struct too_many_writers : std::exception {};
+
+public:
+    using value_type = T;
+    using backoff_type = Backoff;
+    using stats_type = Stats;
+    static constexpr core::u8 max_writers = 1;
+    static constexpr broadcast_mode mode = Mode;
+
+    broadcast_ring(size_t size=1024, size_t max_readers=16)
+    : ring(core::ceil_pow2(size))
+    , _size(ring.size()), _mask(_size - 1)
+    , _max_readers(max_readers)
+    , cursors{new cursor[max_readers]}
+    {
+        if (_size == 0) throw std::length_error("broadcast_ring: size too large");
+        for (auto & slot : ring) slot.tag.store(0, std::memory_order_relaxed);
+    }
+
+    core::queue_writer<broadcast_ring> writer() {
+        if (n_writers < 1) return {*this};
+        else throw too_many_writers{};
+    }
+
+    broadcast_reader<broadcast_ring> reader() { return {*this}; }
+
+
+    /**
+     * @brief [producer] false if the slowest reader is a whole ring behind (never fails in the overwrite mode)
+     */
+    bool try_push(T const& data) {
+        auto w = write_to.load(std::memory_order_relaxed);
+        if constexpr (Mode == broadcast_mode::blocking) {
+            if ( !writable(w) ) { stats.push_failed(); return false; }
+        }
+        auto & slot = ring[w & _mask];
+        if constexpr (Mode == broadcast_mode::overwrite) {
+            slot.tag.store(2*w + 1, std::memory_order_relaxed); // odd: being written
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        slot.data = data;
+        slot.tag.store(2*w + 2, std::memory_order_release);
+        write_to.store(w + 1, std::memory_order_release);
+        stats.pushed();
+        if constexpr (Backoff::parks) not_empty.notify_all(); // every reader wants it
+        return true;
+    }
+
+    // blocking push: false if the ring got closed before the element could be pushed
+    bool push(T const& data) {
+        return core::blocking_wait<Backoff>(not_full,
+            [&]{ return try_push(data); },
+            [&]{ return closed(); },
+            stats
+        );
+    }
+
+
+    size_t capacity() const { return _size; }
+
+    // see queue_stats.hpp: counters().snapshot()
+    Stats const& counters() const { return stats; }
+
+    void close() {
+        active.store(false, std::memory_order_release);
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+    bool closed() const { return !active.load(std::memory_order_acquire); }
+
+
+    void print_state() const {
+        std::cerr << "BR: [-> " << write_to.load() << "] | active: " << std::boolalpha << active.load() << "\n";
+        for (size_t i : core::range(_max_readers)) {
+            auto c = cursors[i].seq.load();
+            if (c != unsubscribed) std::cerr << "  reader #" << i << " @ " << c << "\n";
+        }
+    }
+
+private:
+    // [reader]
+    bool try_pop(size_t id, T & data, seq_type & missed) {
+        auto & cur = cursors[id].seq;
+        auto r = cur.load(std::memory_order_relaxed);
+
+        for (;;) {
+            auto & slot = ring[r & _mask];
+            auto tag = slot.tag.load(std::memory_order_acquire);
+            if ( tag < 2*r + 2 ) { stats.pop_failed(); return false; } // not there yet
+
+            if ( tag == 2*r + 2 ) {
+                data = slot.data;
+                if constexpr (Mode == broadcast_mode::overwrite) {
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if ( slot.tag.load(std::memory_order_relaxed) != tag ) continue; // torn: rewritten while copying
+                }
+                cur.store(r + 1, std::memory_order_release);
+                stats.popped();
+                if constexpr (Mode == broadcast_mode::blocking && Backoff::parks) not_full.notify_one();
+                return true;
+            }
+
+            // lapped by the producer (overwrite mode only): skip to the oldest message still in the ring
+            auto w = write_to.load(std::memory_order_acquire);
+            auto oldest = w > _size ? w - _size : 0;
+            if ( oldest <= r ) oldest = r + 1;
+            missed += oldest - r;
+            r = oldest;
+            cur.store(r, std::memory_order_release);
+        }
+    }
+
+    // blocking pop: false if the ring is closed and this reader has read everything
+    bool pop(size_t id, T & data, seq_type & missed) {
+        return core::blocking_wait<Backoff>(not_empty,
+            [&]{ return try_pop(id, data, missed); },
+            [&]{ return !readable(id); },
+            stats
+        );
+    }
+
+    bool readable(size_t id) const { return !closed() || lag(id) != 0; }
+
+    seq_type lag(size_t id) const {
+        return write_to.load(std::memory_order_acquire) - cursors[id].seq.load(std::memory_order_relaxed);
+    }
+
+    // [producer] the slot for w is free once every reader is past w - size, re-scans the cursors only when the cached minimum says no
+    bool writable(seq_type w) {
+        if ( w - slowest < _size ) return true;
+
+        std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the one in subscribe()
+        seq_type min = w;
+        for (size_t i : core::range(_max_readers)) {
+            auto c = cursors[i].seq.load(std::memory_order_acquire);
+            if ( c < min ) min = c;
+        }
+        slowest = min;
+        return w - slowest < _size;
+    }
+
+    // The cursor is published (at a position the producer has already passed) before the start is picked:
+    // either the producer's next re-scan sees the cursor, or the start re-read after the fence is at least
+    // the position of that re-scan, so the producer's cached minimum never lets it overwrite the reader's first slot.
+    size_t subscribe() {
+        for (size_t i : core::range(_max_readers)) {
+            auto expected = unsubscribed;
+            if ( cursors[i].seq.compare_exchange_strong(expected, write_to.load(std::memory_order_acquire)) ) {
+                std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the one in writable()
+                cursors[i].seq.store(write_to.load(std::memory_order_acquire), std::memory_order_release);
+                return i;
+            }
+        }
+        throw too_many_readers{};
+    }
+
+    void unsubscribe(size_t id) {
+        cursors[id].seq.store(unsubscribed, std::memory_order_release);
+        if constexpr (Mode == broadcast_mode::blocking) not_full.notify_one(); // might have been the slowest one
+    }
+
+
+    std::vector<core::TaggedData<T, std::atomic<seq_type>>> ring; // tag: 2*seq+2 once seq is published (2*seq+1 while being overwritten)
+    const size_t _size; // always a power of two
+    const size_t _mask;
+    const size_t _max_readers;
+    std::unique_ptr<cursor[]> cursors;
+
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<bool> active {true};
+    core::event_count not_empty; // readers park here
+    core::event_count not_full;  // the producer parks here (blocking mode)
+
+    // writer thread:
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<seq_type> write_to {0};
+    seq_type slowest {0}; // cached minimum of the readers' cursors
+    unsigned n_writers {0};
+
+    NO_UNIQUE_ADDRESS Stats stats;
+};
@@ -0,0 +1,242 @@
+// Lamport-style bounded SPSC queue with producer/consumer-local cached indices (a-la FastForward / rigtorp's SPSCQueue).
+// Unlike spsc_queue there are no per-slot tags: the ring holds plain T's and the only shared state is the pair of indices,
+// each side touches the other side's cacheline only when its cached view says the queue is full/empty.
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <type_traits>
+#include <iterator> // std::distance
+#include <algorithm> // std::min
+#include <stdexcept> // length_error
+#include <thread>
+#include <iostream>
+#include "../../cpu.hpp" // cacheline_size
+#include "../../range.hpp"
+#include "../../bits.hpp" // ceil_pow2
+#include "../../ints.hpp"
+#include "../../macros.hpp" // NO_UNIQUE_ADDRESS
+#include "../auxiliary/slot_ref.hpp" // slot_ref
+#include "../auxiliary/event_count.hpp" // event_count, blocking_wait, backoff policies
+#include "../auxiliary/queue_stats.hpp"
+#include "io_descriptors.hpp" // core::{queue_reader, queue_writer}
+
+
+template <typename T, typename size_type=size_t, class Backoff=core::spin_backoff, class Stats=core::no_stats>
+class cached_spsc_queue {
+    static_assert(std::is_unsigned<size_type>::value, "size_type should be unsigned!");
+
+    friend core::queue_reader<cached_spsc_queue>;
+    friend core::queue_writer<cached_spsc_queue>;
+
+    struct too_many_readers : std::exception {};
+    struct too_many_writers : std::exception {};
+
+public:
+    using value_type = T;
+    using backoff_type = Backoff;
+    using stats_type = Stats;
+    static constexpr core::u8 max_writers = 1;
+    static constexpr core::u8 max_readers = 1;
+
+    cached_spsc_queue(size_t size=2048) 
+    : ring(core::ceil_pow2(size)), _size(ring.size()), _mask(_size - 1) {
+        if (_size == 0) throw std::length_error("cached_spsc_queue: size too large");
+    }
+
+    core::queue_reader<cached_spsc_queue> reader() {
+        if (n_readers < 1) return {*this};
+        else throw too_many_readers{};
+    }
+
+    core::queue_writer<cached_spsc_queue> writer() {
+        if (n_writers < 1) return {*this};
+        else throw too_many_writers{};
+    }
+
+
+    bool try_pop(T & data) {
+        auto index = read_from.load(std::memory_order_relaxed);
+        if ( !readable(index, 1) ) { stats.pop_failed(); return false; }
+
+        data = std::move(ring[index & _mask]);
+        read_from.store(index + 1, std::memory_order_release);
+        stats.popped();
+        notify(not_full);
+        return true;
+    }
+
+
+    bool try_push(T const& data) {
+        auto index = write_to.load(std::memory_order_relaxed);
+        if ( !writable(index, 1) ) { stats.push_failed(); return false; }
+
+        ring[index & _mask] = data;
+        write_to.store(index + 1, std::memory_order_release);
+        stats.pushed();
+        notify(not_empty);
+        return true;
+    }
+
+    bool try_push(T && data) {
+        auto index = write_to.load(std::memory_order_relaxed);
+        if ( !writable(index, 1) ) { stats.push_failed(); return false; }
+
+        ring[index & _mask] = std::move(data);
+        write_to.store(index + 1, std::memory_order_release);
+        stats.pushed();
+        notify(not_empty);
+        return true;
+    }
+
+    // blocking push: false if the queue got closed before the element could be pushed
+    bool push(T const& data) {
+        return core::blocking_wait<Backoff>(not_full, 
+            [&]{ return try_push(data); }, 
+            [&]{ return closed(); },
+            stats
+        );
+    }
+
+    // blocking pop: false if the queue is closed and drained
+    bool pop(T & data) {
+        return core::blocking_wait<Backoff>(not_empty, 
+            [&]{ return try_pop(data); }, 
+            [&]{ return !bool(*this); },
+            stats
+        );
+    }
+
+
+    core::slot_ref<T, size_type> reserve() {
+        auto index = write_to.load(std::memory_order_relaxed);
+        if ( !writable(index, 1) ) { stats.push_failed(); return {}; }
+        return {&ring[index & _mask], index};
+    }
+
+    void commit(core::slot_ref<T, size_type> const& slot) {
+        write_to.store(slot.index + 1, std::memory_order_release);
+        stats.pushed();
+        notify(not_empty);
+    }
+
+    core::slot_ref<T, size_type> peek() {
+        auto index = read_from.load(std::memory_order_relaxed);
+        if ( !readable(index, 1) ) { stats.pop_failed(); return {}; }
+        return {&ring[index & _mask], index};
+    }
+
+    void release(core::slot_ref<T, size_type> const& slot) {
+        read_from.store(slot.index + 1, std::memory_order_release);
+        stats.popped();
+        notify(not_full);
+    }
+
+
+    template <typename ForwardIt>
+    size_t try_push_n(ForwardIt first, ForwardIt last) {
+        auto index = write_to.load(std::memory_order_relaxed);
+        const size_t n = std::min<size_t>(std::distance(first, last), _size);
+        if ( n == 0 ) return 0;
+        writable(index, n);
+
+        const size_t count = std::min<size_t>(n, _size - size_type(index - cached_read_from));
+        for (size_t i : core::range(count)) {
+            ring[(index + i) & _mask] = *first;
+            ++first;
+        }
+        if ( count ) {
+            write_to.store(index + count, std::memory_order_release);
+            stats.pushed(count);
+            notify(not_empty);
+        }
+        else stats.push_failed();
+        return count;
+    }
+
+    template <typename OutputIt>
+    size_t try_pop_n(OutputIt out, size_t max) {
+        auto index = read_from.load(std::memory_order_relaxed);
+        const size_t n = std::min<size_t>(max, _size);
+        if ( n == 0 ) return 0;
+        readable(index, n);
+
+        const size_t count = std::min<size_t>(n, size_type(cached_write_to - index));
+        for (size_t i : core::range(count)) {
+            *out = std::move(ring[(index + i) & _mask]);
+            ++out;
+        }
+        if ( count ) {
+            read_from.store(index + count, std::memory_order_release);
+            stats.popped(count);
+            notify(not_full);
+        }
+        else stats.pop_failed();
+        return count;
+    }
+
+
+    size_t capacity() const { return _size; }
+
+    // see queue_stats.hpp: counters().snapshot()
+    Stats const& counters() const { return stats; }
+
+    void close() { 
+        active.store(false, std::memory_order_release); 
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+    bool closed() const { return !active.load(std::memory_order_acquire); }
+    bool empty() const { return write_to.load(std::memory_order_acquire) == read_from.load(std::memory_order_acquire); }
+
+    explicit operator bool () const {
+        return !(closed() && empty());
+    }
+
+
+    void print_state() const {
+        std::cerr << "Q: [" << read_from.load() << " -> " << write_to.load() << "] | active: " << std::boolalpha << active.load() << "\n";
+        std::cerr << "[ " << bool(*this) << " ]\n";
+    }
+
+private:
+    // producer-side: refreshes the cached read index only if the cached view has less than n free slots
+    bool writable(size_type index, size_t n) {
+        if ( _size - size_type(index - cached_read_from) >= n ) return true;
+        cached_read_from = read_from.load(std::memory_order_acquire);
+        return _size - size_type(index - cached_read_from) >= n;
+    }
+
+    // consumer-side: refreshes the cached write index only if the cached view has less than n filled slots
+    bool readable(size_type index, size_t n) {
+        if ( size_type(cached_write_to - index) >= n ) return true;
+        cached_write_to = write_to.load(std::memory_order_acquire);
+        return size_type(cached_write_to - index) >= n;
+    }
+
+    void notify(core::event_count & ec) { if constexpr (Backoff::parks) ec.notify_one(); }
+
+    std::vector<T> ring;
+    const size_type _size; // always a power of two
+    const size_type _mask;
+
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<bool> active {true};
+    core::event_count not_empty; // the consumer parks here
+    core::event_count not_full;  // the producer parks here
+
+    // reader thread:
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<size_type> read_from {0};
+    size_type cached_write_to {0};
+    unsigned n_readers {0};
+
+    // writer thread:
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<size_type> write_to {0};
+    size_type cached_read_from {0};
+    unsigned n_writers {0};
+
+    NO_UNIQUE_ADDRESS Stats stats;
+
+};
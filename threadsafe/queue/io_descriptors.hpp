@@ -1,9 +1,14 @@
 #pragma once
 // #include "../class/interface.hpp"
 #include <exception>
+#include <utility> // move, forward
 
 namespace core {
 
+// for queues that claim the role themselves (atomically, before handing out the descriptor): the descriptor only releases it
+struct role_claimed_t {};
+inline constexpr role_claimed_t role_claimed {};
+
 template <typename Q>
 struct queue_writer {
 public:
@@ -13,6 +18,8 @@ public:
         q.n_writers += 1;
     }
 
+    queue_writer (Q & ref, role_claimed_t) : q{ref} {}
+
     ~queue_writer() { 
         if constexpr (Q::max_writers > 1) {
             if (q.n_writers.fetch_sub(1) == 1) q.close();
@@ -23,7 +30,20 @@ public:
     }
 
     bool try_push(value_type const& data) { return q.try_push(data); }
-    void push(value_type const& data) { q.push(data); }
+    bool try_push(value_type && data) { return q.try_push(std::move(data)); }
+    decltype(auto) push(value_type const& data) { return q.push(data); }
+    decltype(auto) push(value_type && data) { return q.push(std::move(data)); }
+
+    template <typename... Args>
+    bool try_emplace(Args&&... args) { return q.try_emplace(std::forward<Args>(args)...); }
+
+    template <typename ForwardIt>
+    size_t try_push_n(ForwardIt first, ForwardIt last) { return q.try_push_n(first, last); }
+
+    auto reserve() { return q.reserve(); }
+
+    template <typename Slot>
+    void commit(Slot const& slot) { q.commit(slot); }
 
 private: 
     Q & q;
@@ -36,12 +56,23 @@ public:
     using value_type = typename Q::value_type;
 
     queue_reader(Q & ref) : q{ref} { q.n_readers += 1; }
+    queue_reader(Q & ref, role_claimed_t) : q{ref} {}
     ~queue_reader() { q.n_readers -= 1; }
 
     bool try_pop(value_type & data) {
         return q.try_pop(data);
     }
 
+    bool pop(value_type & data) { return q.pop(data); }
+
+    template <typename OutputIt>
+    size_t try_pop_n(OutputIt out, size_t max) { return q.try_pop_n(out, max); }
+
+    auto peek() { return q.peek(); }
+
+    template <typename Slot>
+    void release(Slot const& slot) { q.release(slot); }
+
     operator bool() {
         return bool(q);
     }
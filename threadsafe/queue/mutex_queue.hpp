@@ -1,72 +1,171 @@
-#pragma once 
+#pragma once
 
-#include <queue>
-#include "../../access.hpp"
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <iterator> // std::distance
+#include <algorithm> // std::min
 #include "../../cpu.hpp"
+#include "../../macros.hpp" // NO_UNIQUE_ADDRESS
+#include "../auxiliary/ring_buffer.hpp"
+#include "../auxiliary/queue_stats.hpp"
 
-template <typename T>
+/**
+ * @brief the mutex + condition variable baseline: an unbounded MPMC queue on a contiguous ring buffer
+ * @remark with a Stats policy a park is a wait on the condition variable, there are no CAS / yields to count
+ */
+template <typename T, class Stats=core::no_stats>
 class SimpleQueue {
 public:
-    SimpleQueue() : queue{ std::queue<T>{} } {}
+    using value_type = T;
+    using buffer_type = core::ring_buffer<T>;
+    using stats_type = Stats;
+
+    SimpleQueue(size_t capacity=1024) : queue{capacity} {}
 
     void push(T const& v) {
-        queue->push(v);
+        {
+            std::lock_guard<std::mutex> lock {m};
+            queue.push_back(v);
+        }
+        stats.pushed();
+        not_empty.notify_one();
+    }
+
+    void push(T && v) {
+        {
+            std::lock_guard<std::mutex> lock {m};
+            queue.push_back(std::move(v));
+        }
+        stats.pushed();
+        not_empty.notify_one();
+    }
+
+    // pushes [first, last) under a single lock
+    template <typename ForwardIt>
+    void push_batch(ForwardIt first, ForwardIt last) {
+        const auto n = std::distance(first, last);
+        if (n <= 0) return;
+        {
+            std::lock_guard<std::mutex> lock {m};
+            for (; first != last; ++first) queue.push_back(*first);
+        }
+        stats.pushed(n);
+        if (n == 1) not_empty.notify_one();
+        else not_empty.notify_all();
+    }
+
+    // blocking pop: false if the queue is closed and drained
+    bool pop(T & v) {
+        std::unique_lock<std::mutex> lock {m};
+        if ( queue.empty() && !_closed ) stats.parked();
+        not_empty.wait(lock, [&]{ return !queue.empty() || _closed; });
+        return take(v);
+    }
+
+    // false if nothing came within the timeout (or the queue is closed and drained)
+    template <class Rep, class Period>
+    bool pop_for(T & v, std::chrono::duration<Rep, Period> const& timeout) {
+        std::unique_lock<std::mutex> lock {m};
+        if ( queue.empty() && !_closed ) stats.parked();
+        not_empty.wait_for(lock, timeout, [&]{ return !queue.empty() || _closed; });
+        return take(v);
     }
 
-    T pop() {
-        auto q = queue.lock();
-        auto r = q->front();
-        q->pop();
-        return r;
+    template <class Clock, class Duration>
+    bool pop_until(T & v, std::chrono::time_point<Clock, Duration> const& deadline) {
+        std::unique_lock<std::mutex> lock {m};
+        if ( queue.empty() && !_closed ) stats.parked();
+        not_empty.wait_until(lock, deadline, [&]{ return !queue.empty() || _closed; });
+        return take(v);
     }
 
     bool try_pop(T & v) {
-        auto q = queue.lock();
-        if (q->empty()) return false;
-        v = q->front(); q->pop();
-        return true;
+        std::lock_guard<std::mutex> lock {m};
+        if ( take(v) ) return true;
+        stats.pop_failed();
+        return false;
     }
 
     std::vector<T> pop_batch(size_t expected) {
-        std::vector<T> batch; 
+        std::vector<T> batch;
         batch.reserve(expected);
-        auto q = queue.lock();
-        for (size_t i=0; i < std::min(expected, q->size()); i++) {
-            // if (q->empty()) break;
-            batch.push_back(q->front());
-            q->pop();
+        std::lock_guard<std::mutex> lock {m};
+        const auto n = std::min(expected, queue.size());
+        for (size_t i=0; i < n; i++) {
+            batch.push_back(std::move(queue.front()));
+            queue.pop_front();
         }
+        stats.popped(n);
         return batch;
     }
 
     void pop_into(std::vector<T> & batch) {
-        auto q = queue.lock();
-        const auto size = q->size();
-        for (size_t i=0; i < std::min(batch.capacity(), size); i++) {
-            batch.push_back(q->front());
-            q->pop();
+        std::lock_guard<std::mutex> lock {m};
+        const auto n = std::min(batch.capacity(), queue.size());
+        for (size_t i=0; i < n; i++) {
+            batch.push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+        stats.popped(n);
+    }
+
+    /**
+     * @brief takes everything queued at once: swaps the internal buffer with `out` under the lock
+     * @remark `out` is cleared first, its storage becomes the queue's, so passing the same buffer every time allocates nothing
+     */
+    size_t drain_all(buffer_type & out) {
+        out.clear();
+        {
+            std::lock_guard<std::mutex> lock {m};
+            queue.swap(out);
         }
+        stats.popped(out.size());
+        return out.size();
     }
 
-    bool empty() {
-        return queue->empty();
+    bool empty() const {
+        std::lock_guard<std::mutex> lock {m};
+        return queue.empty();
     }
 
     void close() {
-        _closed.store(true, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock {m};
+            _closed = true;
+        }
+        not_empty.notify_all();
     }
 
     bool closed() const {
-        return _closed.load(std::memory_order_acquire);
+        std::lock_guard<std::mutex> lock {m};
+        return _closed;
     }
 
-    explicit operator bool() { return !closed() || !empty(); }
+    explicit operator bool() const {
+        std::lock_guard<std::mutex> lock {m};
+        return !_closed || !queue.empty();
+    }
+
+    // see queue_stats.hpp: counters().snapshot()
+    Stats const& counters() const { return stats; }
 
 private:
-    core::access< std::queue<T> > queue;
-    
+    // under the lock
+    bool take(T & v) {
+        if (queue.empty()) return false;
+        v = std::move(queue.front());
+        queue.pop_front();
+        stats.popped();
+        return true;
+    }
+
     alignas(core::device::CPU::cacheline_size)
-    std::atomic<bool> _closed {false};
+    mutable std::mutex m; // the const observers lock it too
+    std::condition_variable not_empty;
+    buffer_type queue;
+    bool _closed {false};
 
-    std::atomic<unsigned> n_writers {0};
-};
\ No newline at end of file
+    NO_UNIQUE_ADDRESS Stats stats;
+};
@@ -0,0 +1,347 @@
+// Concurrent priority queues:
+//  - leveled_priority_queue<T, Levels, N>: a small fixed number of priority levels, each a bounded_mpmc<T, N> ring,
+//    plus an atomic bitmap of the possibly non-empty levels; pops take from the most urgent (lowest) non-empty level, FIFO within a level.
+//  - multi_queue<T, Compare>: a relaxed priority queue for general keys (MultiQueue, H.Rihani, P.Sanders, R.Dementiev, SPAA'15):
+//    c*threads sequential heaps behind try-locks, a push goes to a random heap, a pop takes the better top of two random heaps.
+//    Pops return one of the top elements rather than the very top one, in exchange it scales with the number of threads.
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <vector>
+#include <algorithm> // push_heap, pop_heap
+#include <functional> // less
+#include <thread>
+#include <utility> // move, forward
+#include <iostream>
+#include "../../cpu.hpp" // cacheline_size
+#include "../../range.hpp"
+#include "../../ints.hpp"
+#include "../../macros.hpp" // NO_UNIQUE_ADDRESS
+#include "../auxiliary/backoff.hpp" // cpu_relax
+#include "../auxiliary/event_count.hpp" // event_count, blocking_wait, backoff policies
+#include "../auxiliary/queue_stats.hpp"
+#include "b_mpmc.hpp"
+#include "io_descriptors.hpp" // core::{queue_reader, queue_writer}
+
+
+template <typename Q>
+class priority_writer {
+public:
+    using value_type = typename Q::value_type;
+
+    priority_writer(Q & ref) : q{ref} { q.n_writers.fetch_add(1); }
+    ~priority_writer() { if (q.n_writers.fetch_sub(1) == 1) q.close(); }
+
+    bool try_push(size_t level, value_type const& data) { return q.try_push(level, data); }
+    bool try_push(size_t level, value_type && data) { return q.try_push(level, std::move(data)); }
+    bool push(size_t level, value_type const& data) { return q.push(level, data); }
+    bool push(size_t level, value_type && data) { return q.push(level, std::move(data)); }
+
+private:
+    Q & q;
+};
+
+
+/**
+ * @brief Levels priority levels (0 is the most urgent) of N slots each
+ */
+template <typename T, size_t Levels, size_t N=1024, class Backoff=core::spin_backoff, class Stats=core::no_stats>
+class leveled_priority_queue {
+    static_assert(Levels > 0 && Levels <= 64, "the level bitmap is a single 64-bit word");
+
+    // the levels never park on their own, the queue does the waiting & notifying with its Backoff
+    using level_type = bounded_mpmc<T, N, unsigned, core::spin_backoff>;
+
+    friend core::queue_reader<leveled_priority_queue>;
+    friend priority_writer<leveled_priority_queue>;
+
+public:
+    using value_type = T;
+    using backoff_type = Backoff;
+    using stats_type = Stats;
+    static constexpr size_t levels = Levels;
+
+    priority_writer<leveled_priority_queue> writer() { return {*this}; }
+    core::queue_reader<leveled_priority_queue> reader() { return {*this}; }
+
+
+    // level < Levels, 0 is the most urgent
+    bool try_push(size_t level, T const& data) {
+        assert(level < Levels && "leveled_priority_queue: no such level");
+        if ( !queues[level].try_push(data) ) { stats.push_failed(); return false; }
+        published(level);
+        return true;
+    }
+
+    bool try_push(size_t level, T && data) {
+        assert(level < Levels && "leveled_priority_queue: no such level");
+        if ( !queues[level].try_push(std::move(data)) ) { stats.push_failed(); return false; }
+        published(level);
+        return true;
+    }
+
+    // pops from the most urgent non-empty level
+    bool try_pop(T & data) {
+        auto bits = non_empty.load(std::memory_order_seq_cst);
+        while ( bits ) {
+            const auto level = lowest_bit(bits);
+            auto & q = queues[level];
+            // a failed try_pop on a non-empty level means a lost race for the front slot: worth a few retries
+            for (int attempt = 0; attempt < 4; ++attempt) {
+                if ( q.try_pop(data) ) {
+                    stats.popped();
+                    if constexpr (Backoff::parks) not_full.notify_all(); // only the writers of this level can use the slot
+                    return true;
+                }
+                if ( q.empty() ) break;
+            }
+            if ( q.empty() ) {
+                non_empty.fetch_and(~(core::u64(1) << level), std::memory_order_seq_cst);
+                // a push might have slipped in between the empty() check and the clear
+                if ( !q.empty() ) non_empty.fetch_or(core::u64(1) << level, std::memory_order_seq_cst);
+            }
+            bits &= bits - 1;
+        }
+        stats.pop_failed();
+        return false;
+    }
+
+    // blocking push: false if the queue got closed before the element could be pushed
+    bool push(size_t level, T const& data) {
+        return core::blocking_wait<Backoff>(not_full,
+            [&]{ return try_push(level, data); },
+            [&]{ return closed(); },
+            stats
+        );
+    }
+
+    bool push(size_t level, T && data) {
+        return core::blocking_wait<Backoff>(not_full,
+            [&]{ return try_push(level, std::move(data)); },
+            [&]{ return closed(); },
+            stats
+        );
+    }
+
+    // blocking pop: false if the queue is closed and drained
+    bool pop(T & data) {
+        return core::blocking_wait<Backoff>(not_empty,
+            [&]{ return try_pop(data); },
+            [&]{ return !bool(*this); },
+            stats
+        );
+    }
+
+
+    void close() {
+        active.store(false, std::memory_order_release);
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+    bool closed() const { return !active.load(std::memory_order_acquire); }
+
+    bool empty() const {
+        for (auto & q : queues) if ( !q.empty() ) return false;
+        return true;
+    }
+
+    explicit operator bool () const { return !(closed() && empty()); }
+
+    // see queue_stats.hpp: counters().snapshot()
+    Stats const& counters() const { return stats; }
+
+
+    void print_state() const {
+        std::cerr << "PQ: levels: " << std::hex << non_empty.load() << std::dec << " | active: " << std::boolalpha << active.load() << "\n";
+    }
+
+private:
+    void published(size_t level) {
+        non_empty.fetch_or(core::u64(1) << level, std::memory_order_seq_cst);
+        stats.pushed();
+        if constexpr (Backoff::parks) not_empty.notify_one();
+    }
+
+    static size_t lowest_bit(core::u64 bits) {
+    #if defined __GNUC__ || defined __clang__
+        return size_t(__builtin_ctzll(bits));
+    #else
+        size_t n = 0;
+        while ( !(bits & 1) ) { bits >>= 1; ++n; }
+        return n;
+    #endif
+    }
+
+    level_type queues[Levels];
+
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<core::u64> non_empty {0}; // bit i: level i might have elements
+
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<bool> active {true};
+    core::event_count not_empty; // consumers park here
+    core::event_count not_full;  // producers park here
+    std::atomic<unsigned> n_writers {0};
+    std::atomic<unsigned> n_readers {0};
+
+    NO_UNIQUE_ADDRESS Stats stats;
+};
+
+
+
+/**
+ * @brief relaxed concurrent priority queue (MultiQueue): top = the greatest element w.r.t. Compare, like std::priority_queue
+ * @param n_heaps defaults to 2 heaps per hardware thread
+ */
+template <typename T, class Compare=std::less<T>, class Backoff=core::spin_backoff, class Stats=core::no_stats>
+class multi_queue {
+    struct alignas(core::device::CPU::cacheline_size) heap {
+        bool try_lock() { return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire); }
+        void unlock() { locked.store(false, std::memory_order_release); }
+
+        std::atomic<bool> locked {false};
+        std::vector<T> items;
+    };
+
+    friend core::queue_reader<multi_queue>;
+    friend core::queue_writer<multi_queue>;
+
+public:
+    using value_type = T;
+    using backoff_type = Backoff;
+    using stats_type = Stats;
+    static constexpr size_t max_writers = -1;
+    static constexpr size_t max_readers = -1;
+
+    multi_queue(size_t n_heaps = 2 * std::thread::hardware_concurrency(), Compare const& compare = Compare{})
+    : _n_heaps{n_heaps < 2 ? 2 : n_heaps}, heaps{new heap[_n_heaps]}, less{compare} {}
+
+    core::queue_writer<multi_queue> writer() { return {*this}; }
+    core::queue_reader<multi_queue> reader() { return {*this}; }
+
+
+    // never fails: the heaps grow
+    bool try_push(T const& data) { return emplace(data); }
+    bool try_push(T && data) { return emplace(std::move(data)); }
+
+    bool push(T const& data) { return emplace(data); }
+    bool push(T && data) { return emplace(std::move(data)); }
+
+    /**
+     * @brief pops the better top of two random heaps (one of the greatest elements, not necessarily the greatest)
+     */
+    bool try_pop(T & data) {
+        for (size_t attempt = 0; attempt < 2 * _n_heaps; ++attempt) {
+            if ( count.load(std::memory_order_acquire) == 0 ) break;
+
+            auto & a = heaps[random() % _n_heaps];
+            if ( !a.try_lock() ) { stats.cas_failed(); continue; }
+            auto * b = &heaps[random() % _n_heaps];
+            if ( b == &a || !b->try_lock() ) b = nullptr;
+
+            heap * best = better(&a, b);
+            bool popped = best && take(*best, data);
+            if ( b ) b->unlock();
+            a.unlock();
+            if ( popped ) { stats.popped(); return true; }
+        }
+        if ( count.load(std::memory_order_acquire) == 0 ) { stats.pop_failed(); return false; }
+        // unlucky with the random picks: sweep all the heaps
+        for (size_t i : core::range(_n_heaps)) {
+            auto & h = heaps[i];
+            while ( !h.try_lock() ) core::cpu_relax();
+            bool popped = take(h, data);
+            h.unlock();
+            if ( popped ) { stats.popped(); return true; }
+        }
+        stats.pop_failed();
+        return false;
+    }
+
+    // blocking pop: false if the queue is closed and drained
+    bool pop(T & data) {
+        return core::blocking_wait<Backoff>(not_empty,
+            [&]{ return try_pop(data); },
+            [&]{ return !bool(*this); },
+            stats
+        );
+    }
+
+
+    void close() {
+        active.store(false, std::memory_order_release);
+        not_empty.notify_all();
+    }
+    bool closed() const { return !active.load(std::memory_order_acquire); }
+    bool empty() const { return count.load(std::memory_order_acquire) == 0; }
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+
+    explicit operator bool () const { return !(closed() && empty()); }
+
+    // see queue_stats.hpp: counters().snapshot()
+    Stats const& counters() const { return stats; }
+
+
+    void print_state() const {
+        std::cerr << "MQ: " << _n_heaps << " heaps, " << size() << " elements | active: " << std::boolalpha << active.load() << "\n";
+    }
+
+private:
+    template <typename U>
+    bool emplace(U && data) {
+        for (;;) {
+            auto & h = heaps[random() % _n_heaps];
+            if ( !h.try_lock() ) { stats.cas_failed(); continue; }
+            h.items.push_back(std::forward<U>(data));
+            std::push_heap(h.items.begin(), h.items.end(), less);
+            count.fetch_add(1, std::memory_order_release);
+            h.unlock();
+            stats.pushed();
+            if constexpr (Backoff::parks) not_empty.notify_one();
+            return true;
+        }
+    }
+
+    // both locked (b may be null)
+    heap * better(heap * a, heap * b) const {
+        if ( !b || b->items.empty() ) return a->items.empty() ? nullptr : a;
+        if ( a->items.empty() ) return b;
+        return less(a->items.front(), b->items.front()) ? b : a;
+    }
+
+    // locked
+    bool take(heap & h, T & data) {
+        if ( h.items.empty() ) return false;
+        std::pop_heap(h.items.begin(), h.items.end(), less);
+        data = std::move(h.items.back());
+        h.items.pop_back();
+        count.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // per-thread xorshift64
+    static core::u64 random() noexcept {
+        thread_local core::u64 state = 0x9E3779B97F4A7C15ull ^ std::hash<std::thread::id>{}(std::this_thread::get_id());
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    const size_t _n_heaps;
+    std::unique_ptr<heap[]> heaps;
+    Compare less;
+
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<size_t> count {0};
+
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<bool> active {true};
+    core::event_count not_empty; // consumers park here
+    std::atomic<unsigned> n_writers {0};
+    std::atomic<unsigned> n_readers {0};
+
+    NO_UNIQUE_ADDRESS Stats stats;
+};
@@ -0,0 +1,106 @@
+// core::select: consume from several queue readers (of possibly different queue / value types) at once.
+// The selector polls the readers round-robin starting right after the last one it served (so a busy input can't starve the rest),
+// backs off with the Backoff policy while all of them are empty and gives up once every input is closed and drained.
+// Each queue parks its consumers on an event count of its own, and a thread can't sleep on several of them at once:
+// by default (spin_backoff) the selector never parks and keeps on yielding, with a parking Backoff (default_backoff)
+// the park step is a short sleep that doubles up to max_park instead, trading wake-up latency for an idle core.
+#pragma once
+
+#include <tuple>
+#include <utility> // index_sequence
+#include <type_traits>
+#include <chrono>
+#include <thread>
+#include "../auxiliary/backoff.hpp" // backoff policies
+
+namespace core {
+
+template <class Backoff, typename... Readers>
+class selector {
+    static_assert(sizeof...(Readers) > 0, "select() needs at least one reader");
+    static constexpr size_t n_inputs = sizeof...(Readers);
+    using indices = std::make_index_sequence<n_inputs>;
+
+public:
+    using backoff_type = Backoff;
+
+    static constexpr std::chrono::microseconds min_park {16};
+    static constexpr std::chrono::microseconds max_park {1000};
+
+    selector(Readers&... rs) : readers{rs...} {}
+
+    /**
+     * @brief pops one element from the first ready input, calls f(std::integral_constant<size_t, I>{}, value) on it
+     * @return false if all inputs were empty
+     */
+    template <typename F>
+    bool try_pop(F && f) {
+        for (size_t k = 0; k < n_inputs; ++k) {
+            auto i = (next + k) % n_inputs;
+            if ( try_pop_at(i, f, indices{}) ) {
+                next = (i + 1) % n_inputs;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief waits for an element on any of the inputs (spin -> yield [-> sleep, with a parking Backoff]), see try_pop()
+     * @return false once every input is closed and drained
+     */
+    template <typename F>
+    bool pop(F && f) {
+        Backoff backoff;
+        auto park = min_park;
+        for (;;) {
+            if ( try_pop(f) ) return true;
+            if ( !any_open(indices{}) ) return try_pop(f);
+
+            if ( !backoff() ) continue;
+            std::this_thread::sleep_for(park); // only reached with a parking Backoff
+            if ( park < max_park ) park *= 2;
+        }
+    }
+
+    // true while any of the inputs can still produce an element
+    explicit operator bool () { return any_open(indices{}); }
+
+private:
+    template <typename F, size_t... I>
+    bool try_pop_at(size_t i, F & f, std::index_sequence<I...>) {
+        bool popped = false;
+        (void)( (i == I && (popped = try_pop_from<I>(f), true)) || ... );
+        return popped;
+    }
+
+    template <size_t I, typename F>
+    bool try_pop_from(F & f) {
+        auto & value = std::get<I>(values);
+        if ( !std::get<I>(readers).try_pop(value) ) return false;
+        f(std::integral_constant<size_t, I>{}, value);
+        return true;
+    }
+
+    template <size_t... I>
+    bool any_open(std::index_sequence<I...>) {
+        return ( bool(std::get<I>(readers)) || ... );
+    }
+
+    std::tuple<Readers&...> readers;
+    std::tuple<typename std::decay_t<Readers>::value_type...> values; // pop buffers
+    size_t next {0};
+};
+
+
+/**
+ * @brief a selector over the given readers:
+ *        `auto inputs = core::select(r1, r2); while ( inputs.pop([](auto i, auto & v){...}) );`
+ *        (`core::select<core::default_backoff>(...)` sleeps instead of yielding once the inputs stay empty)
+ */
+template <class Backoff = core::spin_backoff, typename... Readers>
+auto select(Readers&... readers) -> selector<Backoff, Readers...> {
+    return {readers...};
+}
+
+}// namespace core
@@ -0,0 +1,211 @@
+// Sharded MPMC queue: a set of bounded_mpmc rings instead of a single one, so that producers and consumers
+// don't all contend on the same write_to / read_from.
+// Every writer / reader descriptor gets a home shard (round-robin), writers only push to their home shard
+// (keeps the per-producer FIFO order), readers pop from their home shard first and steal from the others when it's empty.
+// There's no global FIFO order between the elements pushed by different writers.
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility> // move, forward
+#include <iostream>
+#include "../../cpu.hpp" // cacheline_size
+#include "../../range.hpp"
+#include "../../macros.hpp" // NO_UNIQUE_ADDRESS
+#include "../auxiliary/event_count.hpp" // event_count, blocking_wait, backoff policies
+#include "../auxiliary/queue_stats.hpp"
+#include "b_mpmc.hpp"
+
+
+template <typename Q>
+class sharded_writer {
+public:
+    using value_type = typename Q::value_type;
+
+    sharded_writer(Q & ref, size_t home) : q{ref}, home{home} { q.n_writers.fetch_add(1); }
+    ~sharded_writer() { if (q.n_writers.fetch_sub(1) == 1) q.close(); }
+
+    bool try_push(value_type const& data) { return q.try_push(home, data); }
+    bool try_push(value_type && data) { return q.try_push(home, std::move(data)); }
+    bool push(value_type const& data) { return q.push(home, data); }
+    bool push(value_type && data) { return q.push(home, std::move(data)); }
+
+    template <typename... Args>
+    bool try_emplace(Args&&... args) { return q.try_emplace(home, std::forward<Args>(args)...); }
+
+    size_t shard() const { return home; }
+
+private:
+    Q & q;
+    size_t home;
+};
+
+
+template <typename Q>
+class sharded_reader {
+public:
+    using value_type = typename Q::value_type;
+
+    sharded_reader(Q & ref, size_t home) : q{ref}, home{home} { q.n_readers.fetch_add(1); }
+    ~sharded_reader() { q.n_readers.fetch_sub(1); }
+
+    bool try_pop(value_type & data) { return q.try_pop(home, data); }
+    bool pop(value_type & data) { return q.pop(home, data); }
+
+    size_t shard() const { return home; }
+
+    explicit operator bool () const { return bool(q); }
+
+private:
+    Q & q;
+    size_t home;
+};
+
+
+/**
+ * @brief MPMC queue made of n_shards bounded_mpmc<T, N> rings (N slots each)
+ * @remark the shards never park on their own, the sharded queue does the waiting & notifying with its Backoff;
+ *         Stats counts the sharded queue's operations (a shard's lost CAS shows up as a failed try-op on that shard)
+ */
+template <typename T, size_t N, class Backoff=core::spin_backoff, class Stats=core::no_stats>
+class sharded_queue {
+    using shard_type = bounded_mpmc<T, N, unsigned, core::spin_backoff>;
+
+    friend sharded_writer<sharded_queue>;
+    friend sharded_reader<sharded_queue>;
+
+public:
+    using value_type = T;
+    using backoff_type = Backoff;
+    using stats_type = Stats;
+
+    sharded_queue(size_t n_shards = std::thread::hardware_concurrency())
+    : _n_shards{n_shards ? n_shards : 1}
+    , shards{new shard_type[_n_shards]} {}
+
+    sharded_writer<sharded_queue> writer() {
+        return {*this, next_writer_shard.fetch_add(1, std::memory_order_relaxed) % _n_shards};
+    }
+
+    sharded_reader<sharded_queue> reader() {
+        return {*this, next_reader_shard.fetch_add(1, std::memory_order_relaxed) % _n_shards};
+    }
+
+
+    bool try_push(size_t shard, T const& data) {
+        if ( !shards[shard].try_push(data) ) { stats.push_failed(); return false; }
+        stats.pushed();
+        notify(not_empty);
+        return true;
+    }
+
+    bool try_push(size_t shard, T && data) {
+        if ( !shards[shard].try_push(std::move(data)) ) { stats.push_failed(); return false; }
+        stats.pushed();
+        notify(not_empty);
+        return true;
+    }
+
+    template <typename... Args>
+    bool try_emplace(size_t shard, Args&&... args) {
+        if ( !shards[shard].try_emplace(std::forward<Args>(args)...) ) { stats.push_failed(); return false; }
+        stats.pushed();
+        notify(not_empty);
+        return true;
+    }
+
+    // home shard first, then steals from the others (round-robin starting from the next one)
+    bool try_pop(size_t home, T & data) {
+        for (size_t i : core::range(_n_shards)) {
+            auto shard = (home + i) % _n_shards;
+            if ( shards[shard].try_pop(data) ) {
+                stats.popped();
+                // only the writers homed on this shard can make use of the freed slot, so wake them all
+                if constexpr (Backoff::parks) not_full.notify_all();
+                return true;
+            }
+        }
+        stats.pop_failed();
+        return false;
+    }
+
+    // blocking push: false if the queue got closed before the element could be pushed
+    bool push(size_t shard, T const& data) {
+        return core::blocking_wait<Backoff>(not_full,
+            [&]{ return try_push(shard, data); },
+            [&]{ return closed(); },
+            stats
+        );
+    }
+
+    bool push(size_t shard, T && data) {
+        return core::blocking_wait<Backoff>(not_full,
+            [&]{ return try_push(shard, std::move(data)); },
+            [&]{ return closed(); },
+            stats
+        );
+    }
+
+    // blocking pop: false if the queue is closed and drained
+    bool pop(size_t home, T & data) {
+        return core::blocking_wait<Backoff>(not_empty,
+            [&]{ return try_pop(home, data); },
+            [&]{ return !bool(*this); },
+            stats
+        );
+    }
+
+
+    size_t n_shards() const { return _n_shards; }
+    size_t capacity() const { return _n_shards * N; }
+
+    // see queue_stats.hpp: counters().snapshot()
+    Stats const& counters() const { return stats; }
+
+    void close() {
+        active.store(false, std::memory_order_release);
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+    bool closed() const { return !active.load(std::memory_order_acquire); }
+
+    bool empty() const {
+        for (size_t i : core::range(_n_shards)) {
+            if ( !shards[i].empty() ) return false;
+        }
+        return true;
+    }
+
+    explicit operator bool () const {
+        return !(closed() && empty());
+    }
+
+
+    void print_state() const {
+        for (size_t i : core::range(_n_shards)) {
+            std::cerr << "shard #" << i << ": ";
+            shards[i].print_state();
+        }
+        std::cerr << "active: " << std::boolalpha << active.load() << "\n";
+    }
+
+private:
+    void notify(core::event_count & ec) { if constexpr (Backoff::parks) ec.notify_one(); }
+
+    const size_t _n_shards;
+    std::unique_ptr<shard_type[]> shards;
+
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<bool> active {true};
+    core::event_count not_empty; // consumers park here
+    core::event_count not_full;  // producers park here
+
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<size_t> next_writer_shard {0};
+    std::atomic<size_t> next_reader_shard {0};
+    std::atomic<unsigned> n_writers {0};
+    std::atomic<unsigned> n_readers {0};
+
+    NO_UNIQUE_ADDRESS Stats stats;
+};
@@ -0,0 +1,251 @@
+// Inter-process bounded SPSC queue: the whole queue (header, indices, `active` flag and the ring) is placement-constructed
+// into a caller-supplied region (mmap(MAP_SHARED) / shm_open), so that a producer and a consumer in different processes
+// share a lock-free channel with no syscalls on the hot path.
+// Same Lamport / cached-indices design as cached_spsc_queue, with a fixed layout:
+//  [ header | active, n_readers, n_writers | read_from, cached_write_to | write_to, cached_read_from | ring: T[capacity] ]
+// each group on cacheline(s) of its own. The header records the layout version, sizeof / alignof T and the capacity,
+// attach() refuses a region that was created with a different layout.
+#pragma once
+
+#include <atomic>
+#include <new> // placement new
+#include <cstdint> // uintptr_t
+#include <type_traits>
+#include <iterator> // std::distance
+#include <algorithm> // std::min
+#include <exception>
+#include <thread>
+#include <iostream>
+#include "../../cpu.hpp" // cacheline_size
+#include "../../range.hpp"
+#include "../../bits.hpp" // is_pow2, ceil_pow2
+#include "../../ints.hpp"
+#include "../auxiliary/backoff.hpp" // backoff policies
+#include "io_descriptors.hpp" // core::{queue_reader, queue_writer}
+
+
+template <typename T, class Backoff=core::spin_backoff>
+class alignas(core::device::CPU::cacheline_size) shm_spsc_queue {
+    // the data is copied byte-wise between address spaces, it can't own anything
+    static_assert(std::is_trivially_copyable<T>::value, "shm_spsc_queue<T> requires a trivially copyable T");
+    static_assert(alignof(T) <= size_t(core::device::CPU::cacheline_size), "T is over-aligned for the ring");
+    // atomics in a shared mapping only work across processes if they're address-free, i.e. lock-free
+    static_assert(std::atomic<core::u64>::is_always_lock_free && std::atomic<bool>::is_always_lock_free,
+        "shm_spsc_queue needs lock-free 64-bit atomics");
+
+    friend core::queue_reader<shm_spsc_queue>;
+    friend core::queue_writer<shm_spsc_queue>;
+
+    struct too_many_readers : std::exception {};
+    struct too_many_writers : std::exception {};
+
+    using index_type = core::u64; // fixed width: both processes must agree on the layout
+
+    static constexpr core::u64 magic_value = 0x43'4F'52'45'53'50'53'43; // "CORESPSC"
+
+public:
+    using value_type = T;
+    using backoff_type = Backoff;
+    static constexpr core::u8 max_writers = 1;
+    static constexpr core::u8 max_readers = 1;
+    static constexpr core::u32 layout_version = 1;
+
+    struct region_too_small : std::exception {};
+    struct bad_alignment : std::exception {};
+    struct layout_mismatch : std::exception {}; // not a queue, or created with a different version / T / capacity
+
+    /**
+     * @brief bytes needed for a queue of `capacity` (rounded up to a power of two) elements
+     * @throws region_too_small if no region could be that large
+     */
+    static size_t required_size(size_t capacity) {
+        const size_t n = core::ceil_pow2(capacity);
+        if ( n == 0 || n > (size_t(-1) - sizeof(shm_spsc_queue)) / sizeof(T) ) throw region_too_small{};
+        return sizeof(shm_spsc_queue) + n * sizeof(T);
+    }
+
+    /**
+     * @brief constructs a new queue in [region, region + region_size), the region should be cacheline-aligned (mmap-ed memory is)
+     */
+    static shm_spsc_queue * create(void * region, size_t region_size, size_t capacity) {
+        check_region(region);
+        if ( region_size < required_size(capacity) ) throw region_too_small{};
+        return new (region) shm_spsc_queue(core::ceil_pow2(capacity));
+    }
+
+    /**
+     * @brief attaches to a queue another process has create()-ed in the (shared) region
+     * @param capacity the capacity the caller expects, 0 for any
+     */
+    static shm_spsc_queue * attach(void * region, size_t region_size, size_t capacity=0) {
+        check_region(region);
+        if ( region_size < sizeof(shm_spsc_queue) ) throw region_too_small{};
+
+        auto * q = static_cast<shm_spsc_queue*>(region);
+        if ( q->magic.load(std::memory_order_acquire) != magic_value  // published last by the constructor
+          || q->version != layout_version
+          || q->value_size != sizeof(T)
+          || q->value_align != alignof(T)
+          || !core::is_pow2(q->_size)
+          || (capacity && q->_size != core::ceil_pow2(capacity)) ) {
+            throw layout_mismatch{};
+        }
+        if ( region_size < required_size(q->_size) ) throw region_too_small{};
+        return q;
+    }
+
+    shm_spsc_queue(shm_spsc_queue const&) = delete;
+    shm_spsc_queue& operator= (shm_spsc_queue const&) = delete;
+
+
+    // the roles are claimed with a CAS on the counts in the region: one reader & one writer across all the processes
+    core::queue_reader<shm_spsc_queue> reader() {
+        core::u32 free = 0;
+        if ( !n_readers.compare_exchange_strong(free, 1, std::memory_order_acq_rel) ) throw too_many_readers{};
+        return {*this, core::role_claimed};
+    }
+
+    core::queue_writer<shm_spsc_queue> writer() {
+        core::u32 free = 0;
+        if ( !n_writers.compare_exchange_strong(free, 1, std::memory_order_acq_rel) ) throw too_many_writers{};
+        return {*this, core::role_claimed};
+    }
+
+
+    bool try_pop(T & data) {
+        auto index = read_from.load(std::memory_order_relaxed);
+        if ( !readable(index, 1) ) return false;
+
+        data = ring()[index & _mask];
+        read_from.store(index + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(T const& data) {
+        auto index = write_to.load(std::memory_order_relaxed);
+        if ( !writable(index, 1) ) return false;
+
+        ring()[index & _mask] = data;
+        write_to.store(index + 1, std::memory_order_release);
+        return true;
+    }
+
+    // blocking push: false if the queue got closed before the element could be pushed
+    // (spins / yields only: parking would need a process-shared futex)
+    bool push(T const& data) {
+        return wait_for([&]{ return try_push(data); }, [&]{ return closed(); });
+    }
+
+    // blocking pop: false if the queue is closed and drained
+    bool pop(T & data) {
+        return wait_for([&]{ return try_pop(data); }, [&]{ return !bool(*this); });
+    }
+
+
+    template <typename ForwardIt>
+    size_t try_push_n(ForwardIt first, ForwardIt last) {
+        auto index = write_to.load(std::memory_order_relaxed);
+        const size_t n = std::min<size_t>(std::distance(first, last), _size);
+        if ( n == 0 ) return 0;
+        writable(index, n);
+
+        const size_t count = std::min<size_t>(n, _size - (index - cached_read_from));
+        for (size_t i : core::range(count)) {
+            ring()[(index + i) & _mask] = *first;
+            ++first;
+        }
+        if ( count ) write_to.store(index + count, std::memory_order_release);
+        return count;
+    }
+
+    template <typename OutputIt>
+    size_t try_pop_n(OutputIt out, size_t max) {
+        auto index = read_from.load(std::memory_order_relaxed);
+        const size_t n = std::min<size_t>(max, _size);
+        if ( n == 0 ) return 0;
+        readable(index, n);
+
+        const size_t count = std::min<size_t>(n, cached_write_to - index);
+        for (size_t i : core::range(count)) {
+            *out = ring()[(index + i) & _mask];
+            ++out;
+        }
+        if ( count ) read_from.store(index + count, std::memory_order_release);
+        return count;
+    }
+
+
+    size_t capacity() const { return _size; }
+
+    void close() { active.store(false, std::memory_order_release); }
+    bool closed() const { return !active.load(std::memory_order_acquire); }
+    bool empty() const { return write_to.load(std::memory_order_acquire) == read_from.load(std::memory_order_acquire); }
+
+    explicit operator bool () const {
+        return !(closed() && empty());
+    }
+
+
+    void print_state() const {
+        std::cerr << "SHM Q: [" << read_from.load() << " -> " << write_to.load() << "] | capacity: " << _size << " | active: " << std::boolalpha << active.load() << "\n";
+    }
+
+private:
+    shm_spsc_queue(index_type size) : _size{size}, _mask{size - 1} {
+        magic.store(magic_value, std::memory_order_release);
+    }
+
+    static void check_region(void * region) {
+        if ( reinterpret_cast<std::uintptr_t>(region) % alignof(shm_spsc_queue) != 0 ) throw bad_alignment{};
+    }
+
+    // the ring follows the queue object in the region
+    T * ring() noexcept { return reinterpret_cast<T*>(this + 1); }
+
+    // producer-side: refreshes the cached read index only if the cached view has less than n free slots
+    bool writable(index_type index, size_t n) {
+        if ( _size - (index - cached_read_from) >= n ) return true;
+        cached_read_from = read_from.load(std::memory_order_acquire);
+        return _size - (index - cached_read_from) >= n;
+    }
+
+    // consumer-side: refreshes the cached write index only if the cached view has less than n filled slots
+    bool readable(index_type index, size_t n) {
+        if ( cached_write_to - index >= n ) return true;
+        cached_write_to = write_to.load(std::memory_order_acquire);
+        return cached_write_to - index >= n;
+    }
+
+    template <typename TryOp, typename Stop>
+    bool wait_for(TryOp && try_op, Stop && stop) {
+        Backoff backoff;
+        for (;;) {
+            if ( try_op() ) return true;
+            if ( stop() ) return try_op();
+            if ( backoff() ) std::this_thread::yield();
+        }
+    }
+
+    // header: written once by create()
+    std::atomic<core::u64> magic {0};
+    const core::u32 version {layout_version};
+    const core::u32 value_size {sizeof(T)};
+    const core::u32 value_align {alignof(T)};
+    const index_type _size; // always a power of two
+    const index_type _mask;
+
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<bool> active {true};
+    std::atomic<core::u32> n_readers {0};
+    std::atomic<core::u32> n_writers {0};
+
+    // reader process:
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<index_type> read_from {0};
+    index_type cached_write_to {0};
+
+    // writer process:
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<index_type> write_to {0};
+    index_type cached_read_from {0};
+};
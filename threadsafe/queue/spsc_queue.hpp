@@ -2,14 +2,22 @@
 
 #include <atomic>
 #include "../../cpu.hpp" // cacheline_size
-#include "../../range.hpp" 
+#include "../../range.hpp"
+#include "../../bits.hpp" // ceil_pow2 
+#include "../../macros.hpp" // NO_UNIQUE_ADDRESS
 #include "../auxiliary/tagged.hpp" // TaggedData 
+#include "../auxiliary/slot_ref.hpp" // slot_ref 
+#include "../auxiliary/event_count.hpp" // event_count, blocking_wait, backoff policies
+#include "../auxiliary/queue_stats.hpp"
 #include "io_descriptors.hpp" // core::{queue_reader, queue_writer}
 
 #include <vector>
+#include <iterator> // std::distance
+#include <algorithm> // std::min
+#include <stdexcept> // length_error
 
 
-template <typename T, typename size_type=unsigned>
+template <typename T, typename size_type=unsigned, class Backoff=core::spin_backoff, class Stats=core::no_stats>
 class spsc_queue {
     friend core::queue_reader<spsc_queue>;
     friend core::queue_writer<spsc_queue>;
@@ -19,10 +27,14 @@ class spsc_queue {
 
 public:
     using value_type = T;
+    using backoff_type = Backoff;
+    using stats_type = Stats;
     static constexpr core::u8 max_writers = 1;
     static constexpr core::u8 max_readers = 1;
 
-    spsc_queue(size_t size=2048) : ring(size), _size(size) {
+    spsc_queue(size_t size=2048) 
+    : ring(core::ceil_pow2(size)), _size(ring.size()), _mask(_size - 1) {
+        if (_size == 0) throw std::length_error("spsc_queue: size too large");
         for (auto& elem : ring) {
             elem.tag.store(false);
         }
@@ -42,7 +54,7 @@ public:
     bool try_pop(T & data) {
         auto index = read_from + 1;
 
-        auto& slot = ring[index % _size];
+        auto& slot = ring[index & _mask];
         auto filled = slot.tag.load(std::memory_order_acquire);
 
         if ( filled ) 
@@ -50,8 +62,11 @@ public:
             data = std::move(slot.data);
             slot.tag.store(false, std::memory_order_release);
             read_from = index;
+            stats.popped();
+            notify(not_full);
             return true;
         }
+        stats.pop_failed();
         return false;
     }
 
@@ -59,45 +74,180 @@ public:
     bool try_push(T const& data) {
         auto index = write_to + 1;
 
-        auto& slot = ring[index % _size];
+        auto& slot = ring[index & _mask];
         auto filled = slot.tag.load(std::memory_order_acquire);
 
         if ( !filled ) { 
                 slot.data = data;
                 slot.tag.store(true, std::memory_order_release);
                 write_to = index;
+                stats.pushed();
+                notify(not_empty);
                 return true;
         }
+        stats.push_failed();
         return false;
     }
 
     bool try_push(T && data) {
         auto index = write_to + 1;
 
-        auto& slot = ring[index % _size];
+        auto& slot = ring[index & _mask];
         auto filled = slot.tag.load(std::memory_order_acquire);
 
         if ( !filled ) { 
                 slot.data = std::move(data);
                 slot.tag.store(true, std::memory_order_release);
                 write_to = index;
+                stats.pushed();
+                notify(not_empty);
                 return true;
         }
+        stats.push_failed();
         return false;
     }
 
-    void push(T const& data) {
-        constexpr size_t n_spinwaits = 1;//100000;
-        // std::cerr << "push...\n";
-        for (;;) {
-            // std::cerr << ".";
-            for (size_t _ : core::range(n_spinwaits)) { if (try_push(data)) return; }
-            std::this_thread::yield();
+    /**
+     * @brief zero-copy push: returns a writable slot (empty if the queue is full), 
+     *        the slot is published by commit()
+     */
+    core::slot_ref<T, size_type> reserve() {
+        auto index = write_to + 1;
+
+        auto& slot = ring[index & _mask];
+        if ( !slot.tag.load(std::memory_order_acquire) ) {
+            return {&slot.data, index};
+        }
+        stats.push_failed();
+        return {};
+    }
+
+    void commit(core::slot_ref<T, size_type> const& slot) {
+        ring[slot.index & _mask].tag.store(true, std::memory_order_release);
+        write_to = slot.index;
+        stats.pushed();
+        notify(not_empty);
+    }
+
+    /**
+     * @brief zero-copy pop: returns the front slot to be read in-place (empty if there's none), 
+     *        the slot is handed back to the producer by release()
+     */
+    core::slot_ref<T, size_type> peek() {
+        auto index = read_from + 1;
+
+        auto& slot = ring[index & _mask];
+        if ( slot.tag.load(std::memory_order_acquire) ) {
+            return {&slot.data, index};
+        }
+        stats.pop_failed();
+        return {};
+    }
+
+    void release(core::slot_ref<T, size_type> const& slot) {
+        ring[slot.index & _mask].tag.store(false, std::memory_order_release);
+        read_from = slot.index;
+        stats.popped();
+        notify(not_full);
+    }
+
+    /**
+     * @brief pushes as many elements of [first, last) as there are free slots
+     * @remark the whole batch is published with a single release fence
+     * @return the number of elements pushed
+     */
+    template <typename ForwardIt>
+    size_t try_push_n(ForwardIt first, ForwardIt last) {
+        const size_t n = std::min<size_t>(std::distance(first, last), _size);
+
+        size_t count = 0;
+        while ( count < n && !ring[(write_to + 1 + count) & _mask].tag.load(std::memory_order_relaxed) ) {
+            ++count;
+        }
+        if ( count == 0 ) { stats.push_failed(); return 0; }
+        std::atomic_thread_fence(std::memory_order_acquire); // the consumer is done with those slots
+
+        for (size_t i : core::range(count)) {
+            ring[(write_to + 1 + i) & _mask].data = *first;
+            ++first;
+        }
+
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i : core::range(count)) {
+            ring[(write_to + 1 + i) & _mask].tag.store(true, std::memory_order_relaxed);
         }
+        write_to += count;
+        stats.pushed(count);
+        notify(not_empty);
+        return count;
+    }
+
+    /**
+     * @brief pops up to `max` elements into the output iterator `out`
+     * @remark the freed slots are handed back to the producer with a single release fence
+     * @return the number of elements popped
+     */
+    template <typename OutputIt>
+    size_t try_pop_n(OutputIt out, size_t max) {
+        const size_t n = std::min<size_t>(max, _size);
+
+        size_t count = 0;
+        while ( count < n && ring[(read_from + 1 + count) & _mask].tag.load(std::memory_order_relaxed) ) {
+            ++count;
+        }
+        if ( count == 0 ) { stats.pop_failed(); return 0; }
+        std::atomic_thread_fence(std::memory_order_acquire); // the producer is done with those slots
+
+        for (size_t i : core::range(count)) {
+            *out = std::move(ring[(read_from + 1 + i) & _mask].data);
+            ++out;
+        }
+
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i : core::range(count)) {
+            ring[(read_from + 1 + i) & _mask].tag.store(false, std::memory_order_relaxed);
+        }
+        read_from += count;
+        stats.popped(count);
+        notify(not_full);
+        return count;
+    }
+
+    /**
+     * @brief blocking push: spins and yields (and parks, with a parking Backoff) until there's a free slot
+     * @return false if the queue got closed before the element could be pushed
+     */
+    bool push(T const& data) {
+        return core::blocking_wait<Backoff>(not_full, 
+            [&]{ return try_push(data); }, 
+            [&]{ return closed(); },
+            stats
+        );
+    }
+
+    /**
+     * @brief blocking pop: spins and yields (and parks, with a parking Backoff) until there's an element
+     * @return false if the queue is closed and drained
+     */
+    bool pop(T & data) {
+        return core::blocking_wait<Backoff>(not_empty, 
+            [&]{ return try_pop(data); }, 
+            [&]{ return !bool(*this); },
+            stats
+        );
     }
     
 
-    void close() { active.store(false, std::memory_order_release); }
+    size_t capacity() const { return _size; }
+
+    // see queue_stats.hpp: counters().snapshot()
+    Stats const& counters() const { return stats; }
+
+    void close() { 
+        active.store(false, std::memory_order_release); 
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
     bool closed() const { return !active.load(std::memory_order_acquire); }
     bool empty() const { return write_to == read_from; }
 
@@ -130,11 +280,16 @@ public:
 
 
 private:
+    void notify(core::event_count & ec) { if constexpr (Backoff::parks) ec.notify_one(); }
+
     std::vector< core::TaggedData<T, std::atomic<bool>> > ring;
-    const size_type _size;
+    const size_type _size; // always a power of two
+    const size_type _mask;
 
     alignas(core::device::CPU::cacheline_size) 
     std::atomic<bool> active {true};
+    core::event_count not_empty; // the consumer parks here
+    core::event_count not_full;  // the producer parks here
 
     alignas(core::device::CPU::cacheline_size) 
     size_type read_from {0};
@@ -144,4 +299,6 @@ private:
     size_type write_to {0};
     unsigned n_writers {0};
 
+    NO_UNIQUE_ADDRESS Stats stats;
+
 };
\ No newline at end of file
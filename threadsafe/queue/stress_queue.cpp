@@ -0,0 +1,544 @@
+//! Queue stress test & history checker
+//!
+//! Every round picks random producer / consumer counts, runs them against a small queue (to force wrap-arounds, full / empty
+//! races, segment recycling and parking) with random delays (spins, yields, short sleeps) injected between the operations,
+//! and records every operation with its invocation / response time. The history is then checked for:
+//!  - exactly-once delivery: every pushed element popped once, nothing popped that wasn't pushed (or popped before its push began);
+//!  - per-producer FIFO: each consumer sees the elements of a producer in the order they were pushed;
+//!  - FIFO linearizability (T.A.Henzinger, A.Sezgin, V.Vafeiadis, "Aspect-Oriented Linearizability Proofs", CONCUR'13),
+//!    which for a queue of distinct values comes down to two more violations to look for:
+//!      order: push(a) returned before push(b) began, but pop -> b returned before pop -> a began,
+//!      empty: a try_pop failed while some element was surely in the queue (pushed before it began, popped after it returned).
+//!    The bounded ring queues may fail a try_pop spuriously (the front slot is claimed but not written yet, a lost CAS),
+//!    so for them failed try_pops are counted and reported, not checked.
+//! Build (add -fsanitize=thread for a ThreadSanitizer run):
+//!     g++ -std=c++17 -O1 -g -pthread stress_queue.cpp -o stress_queue
+//!     ./stress_queue [--queues=a,b,...] [--rounds=N] [--items=N] [--threads=N] [--seed=S] [--no-perturb]
+
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <tuple>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include "../../thread.hpp"
+#include "../../range.hpp"
+#include "../../ints.hpp"
+#include "../auxiliary/backoff.hpp" // cpu_relax
+
+#include "spsc_queue.hpp"
+#include "cached_spsc_queue.hpp"
+#include "unbounded_spsc_queue.hpp"
+#include "b_mpmc.hpp"
+#include "sharded_queue.hpp"
+#include "unbounded_mpmc.hpp"
+#include "priority_queue.hpp"
+#include "broadcast_ring.hpp"
+#include "mutex_queue.hpp"
+#include "../bounded_mpmc.hpp"
+
+
+using core::u64;
+using core::i64;
+
+static i64 now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// element = producer id << 32 | sequence number
+static u64 element(u64 producer, u64 seq) { return (producer << 32) | seq; }
+static u64 producer_of(u64 v) { return v >> 32; }
+static u64 seq_of(u64 v) { return v & 0xFFFF'FFFF; }
+
+
+// ===== schedule perturbation =====
+
+class xorshift {
+public:
+    xorshift(u64 seed) : state{seed ? seed : 0x9E3779B97F4A7C15ull} {}
+    u64 operator() () noexcept {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+private:
+    u64 state;
+};
+
+// a random pause between two operations: mostly none, sometimes a spin, a yield or (rarely) a short sleep
+class perturbation {
+public:
+    perturbation(u64 seed, bool enabled) : rng{seed}, enabled{enabled} {}
+
+    void operator() () {
+        if ( !enabled ) return;
+        auto dice = rng() % 1000;
+        if ( dice < 700 ) return;
+        if ( dice < 900 ) { for (u64 i = 0, n = rng() % 256; i < n; ++i) core::cpu_relax(); }
+        else if ( dice < 995 ) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(rng() % 50));
+    }
+
+    u64 random() { return rng(); }
+
+private:
+    xorshift rng;
+    bool enabled;
+};
+
+
+// ===== history =====
+
+struct op {
+    u64 value;
+    i64 inv, res; // invocation / response time
+};
+
+struct interval { i64 inv, res; };
+
+struct history {
+    size_t n_producers {0};
+    size_t per_producer {0};
+    std::vector<std::vector<op>> pushes;       // [producer][seq]
+    std::vector<std::vector<op>> pops;         // [consumer], in the consumer's order
+    std::vector<std::vector<interval>> empties; // [consumer] failed try_pops
+};
+
+// what a queue promises
+struct guarantees {
+    bool fifo;         // a single FIFO order (linearizable push / pop)
+    bool strict_empty; // a try_pop fails only if the queue is empty
+    bool producer_fifo; // per-producer order is kept (FIFO queues, sharded_queue)
+};
+
+struct verdict {
+    size_t pops {0}, empties {0};
+    std::vector<std::string> violations;
+};
+
+
+// for each query (t, bound): is there an element with key < t whose value > bound? (sweep over the elements sorted by key)
+struct witness_sweep {
+    struct item { i64 key, value; u64 id; };
+
+    std::vector<item> items;
+
+    void prepare() { std::sort(items.begin(), items.end(), [](auto & a, auto & b){ return a.key < b.key; }); }
+
+    // queries must come in ascending t
+    bool query(i64 t, i64 bound, u64 & witness) {
+        while ( next < items.size() && items[next].key < t ) {
+            if ( items[next].value > best ) { best = items[next].value; best_id = items[next].id; }
+            ++next;
+        }
+        witness = best_id;
+        return next > 0 && best > bound;
+    }
+
+private:
+    size_t next {0};
+    i64 best {std::numeric_limits<i64>::min()};
+    u64 best_id {0};
+};
+
+
+verdict check(history const& h, guarantees g) {
+    verdict v;
+    auto report = [&](std::string s) { if ( v.violations.size() < 8 ) v.violations.push_back(std::move(s)); };
+    auto name = [](u64 value) { std::ostringstream os; os << "p" << producer_of(value) << "#" << seq_of(value); return os.str(); };
+
+    // exactly-once & fresh
+    std::vector<std::vector<op const*>> popped (h.n_producers, std::vector<op const*>(h.per_producer, nullptr));
+    for (auto & ops : h.pops) {
+        v.pops += ops.size();
+        std::vector<i64> last_seq (h.n_producers, -1);
+        for (auto & o : ops) {
+            auto p = producer_of(o.value), s = seq_of(o.value);
+            if ( p >= h.n_producers || s >= h.per_producer ) { report("popped a value that was never pushed: " + name(o.value)); continue; }
+            if ( popped[p][s] ) { report("popped twice: " + name(o.value)); continue; }
+            popped[p][s] = &o;
+            if ( o.res < h.pushes[p][s].inv ) report("popped before its push began: " + name(o.value));
+            if ( g.producer_fifo ) {
+                if ( i64(s) < last_seq[p] ) report("producer order broken: " + name(o.value) + " after p" + std::to_string(p) + "#" + std::to_string(last_seq[p]));
+                last_seq[p] = i64(s);
+            }
+        }
+    }
+    for (size_t p : core::range(h.n_producers)) {
+        for (size_t s : core::range(h.per_producer)) {
+            if ( !popped[p][s] ) report("lost: " + name(element(p, s)));
+        }
+    }
+    for (auto & e : h.empties) v.empties += e.size();
+    if ( !v.violations.empty() || !g.fifo ) return v;
+
+    // order: push(a).res < push(b).inv && pop(b).res < pop(a).inv
+    // i.e. for b: max{ pop(a).inv : push(a).res < push(b).inv } > pop(b).res
+    witness_sweep sweep;
+    std::vector<std::pair<i64, u64>> queries; // push(b).inv, b
+    for (size_t p : core::range(h.n_producers)) {
+        for (size_t s : core::range(h.per_producer)) {
+            auto & push = h.pushes[p][s];
+            sweep.items.push_back({push.res, popped[p][s]->inv, push.value});
+            queries.push_back({push.inv, push.value});
+        }
+    }
+    sweep.prepare();
+    std::sort(queries.begin(), queries.end());
+    for (auto & [t, b] : queries) {
+        u64 a;
+        if ( sweep.query(t, popped[producer_of(b)][seq_of(b)]->res, a) ) {
+            report("FIFO order: " + name(a) + " was pushed before " + name(b) + " but popped after it");
+        }
+    }
+
+    // empty: push(x).res < fail.inv && pop(x).inv > fail.res
+    if ( g.strict_empty ) {
+        witness_sweep in_queue;
+        in_queue.items = sweep.items; // sorted by push(x).res already
+        std::vector<interval> fails;
+        for (auto & e : h.empties) fails.insert(fails.end(), e.begin(), e.end());
+        std::sort(fails.begin(), fails.end(), [](auto & a, auto & b){ return a.inv < b.inv; });
+        for (auto & f : fails) {
+            u64 x;
+            if ( in_queue.query(f.inv, f.res, x) ) report("try_pop failed while " + name(x) + " was in the queue");
+        }
+    }
+    return v;
+}
+
+
+// ===== queues under test =====
+
+// SimpleQueue behind reader() / writer() descriptors
+template <typename T>
+class locked_queue {
+public:
+    using value_type = T;
+
+    locked_queue(size_t capacity) : q{capacity} {}
+
+    struct writer_type {
+        writer_type(locked_queue & ref) : ref{ref} { ref.n_writers.fetch_add(1); }
+        ~writer_type() { if (ref.n_writers.fetch_sub(1) == 1) ref.q.close(); }
+        bool try_push(T const& v) { ref.q.push(v); return true; }
+        bool push(T const& v) { ref.q.push(v); return true; }
+        locked_queue & ref;
+    };
+
+    struct reader_type {
+        bool try_pop(T & v) { return ref.q.try_pop(v); }
+        bool pop(T & v) { return ref.q.pop(v); }
+        explicit operator bool () { return bool(ref.q); }
+        locked_queue & ref;
+    };
+
+    writer_type writer() { return {*this}; }
+    reader_type reader() { return {*this}; }
+
+private:
+    SimpleQueue<T> q;
+    std::atomic<unsigned> n_writers {0};
+};
+
+// leveled_priority_queue, each element pushed at a level of its own (FIFO holds per level only)
+template <typename T, size_t Levels>
+class leveled_queue {
+public:
+    using value_type = T;
+
+    struct writer_type {
+        bool try_push(T const& v) { return w.try_push(v % Levels, v); }
+        bool push(T const& v) { return w.push(v % Levels, v); }
+        priority_writer<leveled_priority_queue<T, Levels, 4>> w;
+    };
+
+    writer_type writer() { return {q.writer()}; }
+    auto reader() { return q.reader(); }
+
+private:
+    leveled_priority_queue<T, Levels, 4> q;
+};
+
+
+// name, single producer / consumer only, guarantees, make()
+#define STRESS_TARGET(NAME, SINGLE, FIFO, STRICT_EMPTY, PRODUCER_FIFO, ...) \
+    struct NAME { \
+        static constexpr const char* name = #NAME; \
+        static constexpr bool single = SINGLE; \
+        static constexpr guarantees promises {FIFO, STRICT_EMPTY, PRODUCER_FIFO}; \
+        static auto make() { return __VA_ARGS__; } \
+    }
+
+namespace targets {
+    //                                   single fifo   strict producer
+    STRESS_TARGET(spsc_queue,            true,  true,  true,  true,  std::make_unique<::spsc_queue<u64>>(4));
+    STRESS_TARGET(spsc_queue_parking,    true,  true,  true,  true,  std::make_unique<::spsc_queue<u64, unsigned, core::default_backoff>>(4));
+    STRESS_TARGET(cached_spsc_queue,     true,  true,  true,  true,  std::make_unique<::cached_spsc_queue<u64>>(4));
+    STRESS_TARGET(unbounded_spsc_queue,  true,  true,  true,  true,  std::make_unique<::unbounded_spsc_queue<u64, 4>>(2));
+    STRESS_TARGET(bounded_mpmc,          false, true,  false, true,  std::make_unique<::bounded_mpmc<u64, 4>>());
+    STRESS_TARGET(bounded_mpmc_u8_tags,  false, true,  false, true,  std::make_unique<::bounded_mpmc<u64, 4, core::u8>>()); // tags wrap around
+    STRESS_TARGET(bounded_mpmc_parking,  false, true,  false, true,  std::make_unique<::bounded_mpmc<u64, 4, unsigned, core::default_backoff>>());
+    STRESS_TARGET(B_MPMC_Queue,          false, true,  false, true,  std::make_unique<::B_MPMC_Queue<u64, 4>>());
+    STRESS_TARGET(sharded_queue,         false, false, false, true,  std::make_unique<::sharded_queue<u64, 4>>(3));
+    STRESS_TARGET(unbounded_mpmc,        false, true,  false, true,  std::make_unique<::unbounded_mpmc<u64, 8>>());
+    STRESS_TARGET(leveled_priority_queue,false, false, false, false, std::make_unique<leveled_queue<u64, 3>>());
+    STRESS_TARGET(multi_queue,           false, false, false, false, std::make_unique<::multi_queue<u64>>(4));
+    STRESS_TARGET(mutex_queue,           false, true,  true,  true,  std::make_unique<locked_queue<u64>>(4));
+
+    using all = std::tuple<spsc_queue, spsc_queue_parking, cached_spsc_queue, unbounded_spsc_queue, 
+                           bounded_mpmc, bounded_mpmc_u8_tags, bounded_mpmc_parking, B_MPMC_Queue,
+                           sharded_queue, unbounded_mpmc, leveled_priority_queue, multi_queue, mutex_queue>;
+}
+
+#undef STRESS_TARGET
+
+
+// ===== rounds =====
+
+struct config {
+    std::vector<std::string> queues;
+    size_t rounds = 20;
+    size_t items = 20'000; // per round
+    size_t threads = 4;    // max. producers / consumers
+    u64 seed = 0;
+    bool perturb = true;
+};
+
+template <class Target>
+verdict round(config const& cfg, u64 seed) {
+    xorshift rng {seed};
+    const size_t n_producers = Target::single ? 1 : 1 + rng() % cfg.threads;
+    const size_t n_consumers = Target::single ? 1 : 1 + rng() % cfg.threads;
+
+    history h;
+    h.n_producers = n_producers;
+    h.per_producer = std::max<size_t>(1, cfg.items / n_producers);
+    h.pushes.assign(n_producers, std::vector<op>(h.per_producer));
+    h.pops.resize(n_consumers);
+    h.empties.resize(n_consumers);
+
+    auto q = Target::make();
+    std::atomic<size_t> ready {0};
+    std::atomic<bool> go {false};
+    auto wait_for_start = [&] {
+        ready.fetch_add(1);
+        while ( !go.load(std::memory_order_acquire) ) std::this_thread::yield();
+    };
+
+    {// threads
+        std::vector<core::thread> threads;
+
+        for (size_t c : core::range(n_consumers)) {
+            threads.emplace_back( [&, c, seed = rng()] {
+                perturbation pause {seed, cfg.perturb};
+                auto reader = q->reader();
+                auto & pops = h.pops[c];
+                auto & empties = h.empties[c];
+                pops.reserve(cfg.items);
+                wait_for_start();
+
+                u64 v;
+                for (;;) {
+                    pause();
+                    auto inv = now();
+                    if ( pause.random() % 2 ) { // blocking
+                        if ( !reader.pop(v) ) break;
+                        pops.push_back({v, inv, now()});
+                    }
+                    else if ( reader.try_pop(v) ) {
+                        pops.push_back({v, inv, now()});
+                    }
+                    else {
+                        empties.push_back({inv, now()});
+                        if ( !bool(reader) ) break;
+                    }
+                }
+            });
+        }
+
+        for (size_t p : core::range(n_producers)) {
+            threads.emplace_back( [&, p, seed = rng()] {
+                perturbation pause {seed, cfg.perturb};
+                auto writer = q->writer();
+                auto & pushes = h.pushes[p];
+                wait_for_start();
+
+                for (size_t s : core::range(h.per_producer)) {
+                    const auto v = element(p, s);
+                    pause();
+                    if ( pause.random() % 2 ) { // blocking
+                        auto inv = now();
+                        writer.push(v);
+                        pushes[s] = {v, inv, now()};
+                    }
+                    else for (;;) {
+                        auto inv = now();
+                        if ( writer.try_push(v) ) { pushes[s] = {v, inv, now()}; break; }
+                        pause();
+                    }
+                }
+            });
+        }
+
+        while ( ready.load() != n_producers + n_consumers ) std::this_thread::yield();
+        go.store(true, std::memory_order_release);
+    }// threads join
+
+    return check(h, Target::promises);
+}
+
+
+// every reader of a broadcast ring must see the stream in order: the early readers (subscribed before the writer starts)
+// all of it, the late ones (subscribing while the writer is running) a gapless tail of it.
+// The messages are heap-allocated strings: a slot overwritten while a reader copies it shows up as garbage (and in TSan).
+verdict broadcast_round(config const& cfg, u64 seed) {
+    xorshift rng {seed};
+    const size_t n_readers = 1 + rng() % cfg.threads;
+    const size_t n_late = rng() % (n_readers + 1);
+    const size_t n = cfg.items;
+    auto message = [](size_t i) { return "message #" + std::to_string(i) + " (long enough not to fit into the SSO buffer)"; };
+
+    broadcast_ring<std::string> ring {4, n_readers};
+    std::vector<std::vector<std::string>> seen (n_readers);
+    std::vector<u64> missed (n_readers);
+    std::atomic<size_t> ready {0}, pushed {0};
+    verdict v;
+
+    {// threads
+        std::vector<core::thread> threads;
+        for (size_t r : core::range(n_readers)) {
+            const bool late = r >= n_readers - n_late;
+            threads.emplace_back( [&, r, late, start_at = rng() % n, seed = rng()] {
+                perturbation pause {seed, cfg.perturb};
+                auto consume = [&](auto & reader) {
+                    std::string x;
+                    for (;;) {
+                        pause();
+                        if ( pause.random() % 2 ) { if ( !reader.pop(x) ) break; seen[r].push_back(x); }
+                        else if ( reader.try_pop(x) ) seen[r].push_back(x);
+                        else if ( !bool(reader) ) break;
+                    }
+                    missed[r] = reader.missed();
+                };
+                if ( !late ) { // subscribes at the current end of the stream: before the writer starts
+                    auto reader = ring.reader();
+                    ready.fetch_add(1);
+                    consume(reader);
+                }
+                else { // subscribes somewhere in the middle of the stream
+                    ready.fetch_add(1);
+                    while ( pushed.load(std::memory_order_acquire) < start_at ) std::this_thread::yield();
+                    auto reader = ring.reader();
+                    consume(reader);
+                }
+            });
+        }
+        while ( ready.load() != n_readers ) std::this_thread::yield();
+
+        perturbation pause {rng(), cfg.perturb};
+        auto writer = ring.writer();
+        for (size_t i : core::range(n)) {
+            pause();
+            writer.push(message(i));
+            pushed.store(i + 1, std::memory_order_release);
+        }
+    }// threads join
+
+    for (size_t r : core::range(n_readers)) {
+        const auto name = "reader #" + std::to_string(r) + (r >= n_readers - n_late ? " (late)" : "");
+        v.pops += seen[r].size();
+        if ( missed[r] ) v.violations.push_back("a blocking-mode " + name + " missed " + std::to_string(missed[r]) + " messages");
+        if ( r < n_readers - n_late && seen[r].size() != n ) {
+            v.violations.push_back(name + " got " + std::to_string(seen[r].size()) + " of " + std::to_string(n));
+            continue;
+        }
+        const auto first = n - seen[r].size(); // the tail it must have seen
+        for (size_t i : core::range(seen[r].size())) {
+            if ( seen[r][i] != message(first + i) ) { v.violations.push_back(name + ": wrong message at " + std::to_string(first + i) + ": " + seen[r][i]); break; }
+        }
+    }
+    return v;
+}
+
+
+template <typename F, typename... Targets>
+bool with_target(std::string const& name, F && f, std::tuple<Targets...>*) {
+    return ( (name == Targets::name && (f(Targets{}), true)) || ... );
+}
+
+template <typename... Targets>
+std::vector<std::string> target_names(std::tuple<Targets...>*) { return {Targets::name...}; }
+
+
+int main(int argc, char** argv) {
+    config cfg;
+    cfg.seed = u64(now());
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        auto key = arg.substr(0, eq);
+        auto value = eq == std::string::npos ? std::string{} : arg.substr(eq + 1);
+        try {
+            if      ( key == "--queues" )     { std::istringstream in {value}; for (std::string q; std::getline(in, q, ','); ) cfg.queues.push_back(q); }
+            else if ( key == "--rounds" )     cfg.rounds = std::stoull(value);
+            else if ( key == "--items" )      cfg.items = std::max<size_t>(1, std::stoull(value));
+            else if ( key == "--threads" )    cfg.threads = std::max<size_t>(1, std::stoull(value));
+            else if ( key == "--seed" )       cfg.seed = std::stoull(value);
+            else if ( key == "--no-perturb" ) cfg.perturb = false;
+            else throw std::invalid_argument{arg};
+        }
+        catch (std::exception const&) {
+            std::cerr << "usage: " << argv[0] << " [--queues=a,b,...] [--rounds=N] [--items=N] [--threads=N] [--seed=S] [--no-perturb]\n  queues: ";
+            for (auto & name : target_names((targets::all*)nullptr)) std::cerr << name << " ";
+            std::cerr << "broadcast_ring\n";
+            return 1;
+        }
+    }
+    if ( cfg.queues.empty() ) {
+        cfg.queues = target_names((targets::all*)nullptr);
+        cfg.queues.push_back("broadcast_ring");
+    }
+
+    std::cout << "seed: " << cfg.seed << " (rerun with --seed=" << cfg.seed << ")\n";
+    bool all_ok = true;
+
+    for (auto & name : cfg.queues) {
+        size_t pops = 0, empties = 0;
+        bool strict_empty = false;
+        std::vector<std::string> violations;
+        xorshift seeds {cfg.seed ^ std::hash<std::string>{}(name)};
+
+        auto run_rounds = [&](auto && run) {
+            for (size_t r : core::range(cfg.rounds)) {
+                auto round_seed = seeds();
+                auto v = run(round_seed);
+                pops += v.pops;
+                empties += v.empties;
+                for (auto & s : v.violations) violations.push_back("round " + std::to_string(r) + " (seed " + std::to_string(round_seed) + "): " + s);
+                if ( !v.violations.empty() ) break;
+            }
+        };
+
+        bool known = with_target(name, [&](auto target) {
+            strict_empty = decltype(target)::promises.strict_empty;
+            run_rounds([&](u64 seed) { return round<decltype(target)>(cfg, seed); });
+        }, (targets::all*)nullptr);
+        if ( !known && name == "broadcast_ring" ) {
+            run_rounds([&](u64 seed) { return broadcast_round(cfg, seed); });
+            known = true;
+        }
+        if ( !known ) { std::cerr << "unknown queue: " << name << "\n"; all_ok = false; continue; }
+
+        std::cout << name << ": " << (violations.empty() ? "OK" : "FAILED") << " (" << pops << " pops, " << empties << " failed try_pops"
+                  << (strict_empty ? " checked" : "") << ")\n";
+        for (auto & s : violations) std::cout << "  " << s << "\n";
+        all_ok = all_ok && violations.empty();
+    }
+    return all_ok ? 0 : 2;
+}
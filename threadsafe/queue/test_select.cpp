@@ -0,0 +1,127 @@
+//! core::select: round-robin order over the inputs, mixed value types, closing the inputs (with and without a parking Backoff)
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <string>
+#include <chrono>
+#include "../../thread.hpp"
+#include "../../range.hpp"
+
+#include "spsc_queue.hpp"
+#include "b_mpmc.hpp"
+#include "select.hpp"
+
+
+std::string message(size_t i) { return "message #" + std::to_string(i) + " (long enough to live on the heap)"; }
+
+
+// both inputs always ready: the selector alternates between them, an input left alone gets served on its own
+void round_robin() {
+    spsc_queue<int> a {64};
+    bounded_mpmc<std::string, 64> b;
+    auto wa = a.writer(); auto wb = b.writer();
+    auto ra = a.reader(); auto rb = b.reader();
+
+    for (int i : core::range(8)) {
+        wa.push(i);
+        wb.push(message(i));
+    }
+    wa.push(8);
+
+    auto inputs = core::select(ra, rb);
+    std::vector<size_t> order;
+    int next_int = 0;
+    size_t next_string = 0;
+    while ( inputs.try_pop([&](auto i, auto & v) {
+        order.push_back(i);
+        if constexpr (i == 0) { assert(v == next_int); ++next_int; }
+        else                  { assert(v == message(next_string)); ++next_string; }
+    }) );
+
+    assert(next_int == 9 && next_string == 8);
+    for (size_t k : core::range(16)) assert(order[k] == k % 2);
+    assert(order[16] == 0);
+
+    // the next pop starts right after the input served last
+    wb.push(message(8)); wa.push(9);
+    size_t first = 2;
+    inputs.try_pop([&](auto i, auto &) { first = i; });
+    assert(first == 1);
+    std::cout << "round-robin over spsc_queue<int> & bounded_mpmc<std::string>: OK\n";
+}
+
+
+// closed inputs are drained before pop() gives up, an open input keeps the selector going
+void closing() {
+    spsc_queue<int> a {64};
+    bounded_mpmc<std::string, 64> b;
+    auto ra = a.reader(); auto rb = b.reader();
+    auto inputs = core::select(ra, rb);
+
+    {
+        auto wa = a.writer();
+        for (int i : core::range(4)) wa.push(i);
+    }// closes a, 4 elements left in it
+    assert(bool(inputs));
+
+    auto wb = b.writer();
+    wb.push(message(0));
+
+    size_t ints = 0, strings = 0;
+    for (size_t _ : core::range(5)) {
+        (void)_;
+        assert(inputs.pop([&](auto i, auto &) { if constexpr (i == 0) ++ints; else ++strings; }));
+    }
+    assert(ints == 4 && strings == 1);
+    assert(bool(inputs)); // b is still open
+    assert(!inputs.try_pop([](auto, auto &) { assert(false); }));
+
+    b.close();
+    assert(!bool(inputs));
+    assert(!inputs.pop([](auto, auto &) { assert(false); }));
+    std::cout << "closing the inputs: OK\n";
+}
+
+
+// producers on threads, the consumer waits in pop() until every input is closed and drained
+template <class Backoff>
+void producers(char const* name, size_t N, std::chrono::microseconds pause) {
+    spsc_queue<size_t> a {16};
+    bounded_mpmc<std::string, 16> b;
+    auto ra = a.reader(); auto rb = b.reader();
+
+    size_t next_a = 0, next_b = 0;
+    {// threads
+        core::thread pa {[&] {
+            auto wa = a.writer(); // closes the queue once done
+            for (size_t i : core::range(N)) {
+                wa.push(i);
+                if ( i % 64 == 0 ) std::this_thread::sleep_for(pause);
+            }
+        }};
+        core::thread pb {[&] {
+            auto wb = b.writer();
+            for (size_t i : core::range(N / 2)) wb.push(message(i));
+        }};
+
+        auto inputs = core::select<Backoff>(ra, rb);
+        while ( inputs.pop([&](auto i, auto & v) {
+            if constexpr (i == 0) { assert(v == next_a); ++next_a; }
+            else                  { assert(v == message(next_b)); ++next_b; }
+        }) );
+    }// threads join
+
+    assert(next_a == N && next_b == N / 2);
+    std::cout << "producers [" << name << "]: " << N + N / 2 << " elements in order: OK\n";
+}
+
+
+int main() {
+    using namespace std::chrono_literals;
+
+    round_robin();
+    closing();
+    producers<core::spin_backoff>("spin_backoff", 100'000, 0us);
+    producers<core::default_backoff>("default_backoff, sleeping", 20'000, 200us);
+}
@@ -0,0 +1,140 @@
+//! shm_spsc_queue across processes: a fork()-ed consumer over a MAP_SHARED mapping, one reader / writer across the processes,
+//! layout checks on attach (POSIX only)
+//! Build:
+//!     g++ -std=c++17 -O2 -pthread test_shm_spsc_queue.cpp -o test_shm_spsc_queue
+
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../../ints.hpp"
+
+#include "shm_spsc_queue.hpp"
+
+using core::u32;
+using core::u64;
+
+struct message {
+    u64 seq;
+    u64 check;
+};
+
+using queue = shm_spsc_queue<message>;
+
+
+void * map_shared(size_t bytes) {
+    void * region = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    assert(region != MAP_FAILED);
+    return region;
+}
+
+template <typename F>
+bool throws(F && f) {
+    try { f(); } catch (std::exception const&) { return true; }
+    return false;
+}
+
+// runs f in a child process, returns its pid; the child's exit code is f()'s result
+template <typename F>
+pid_t spawn(F && f) {
+    auto pid = fork();
+    assert(pid >= 0);
+    if ( pid == 0 ) _exit(f());
+    return pid;
+}
+
+bool exited_ok(pid_t pid) {
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+
+int main() {
+    constexpr size_t capacity = 1024;
+    constexpr u64 N = 2'000'000;
+    const auto bytes = queue::required_size(capacity);
+
+    {// a producer & a fork()-ed consumer; the roles are taken across the processes
+        void * region = map_shared(bytes);
+        auto * flags = static_cast<std::atomic<u32>*>(map_shared(sizeof(std::atomic<u32>)));
+        new (flags) std::atomic<u32> {0};
+
+        auto * q = queue::create(region, bytes, capacity);
+        auto consumer = spawn([&]() -> int {
+            auto * cq = queue::attach(region, bytes, capacity);
+            auto reader = cq->reader();
+            if ( !throws([&]{ cq->reader(); }) ) return 1; // a second reader in the same process
+            flags->store(1, std::memory_order_release);
+
+            message m;
+            u64 expected = 0;
+            while ( reader.pop(m) ) {
+                if ( m.seq != expected || m.check != ~m.seq ) return 2;
+                ++expected;
+            }
+            return expected == N ? 0 : 3;
+        });
+
+        while ( flags->load(std::memory_order_acquire) == 0 ) std::this_thread::yield();
+        assert(throws([&]{ q->reader(); })); // the consumer process holds the reader
+
+        {
+            auto writer = q->writer();
+            assert(throws([&]{ q->writer(); }));
+            for (u64 i = 0; i < N; ++i) writer.push({i, ~i});
+        }// closes the queue
+
+        assert(exited_ok(consumer));
+        munmap(flags, sizeof(std::atomic<u32>));
+        munmap(region, bytes);
+        std::cout << "fork()-ed consumer: " << N << " messages in order, second reader / writer rejected: OK\n";
+    }
+
+    {// processes racing for the reader: exactly one gets it
+        constexpr u32 racers = 8;
+        void * region = map_shared(bytes);
+        auto * counters = static_cast<std::atomic<u32>*>(map_shared(3 * sizeof(std::atomic<u32>)));
+        auto & go = *new (counters) std::atomic<u32> {0};
+        auto & won = *new (counters + 1) std::atomic<u32> {0};
+        auto & tried = *new (counters + 2) std::atomic<u32> {0};
+        queue::create(region, bytes, capacity);
+
+        pid_t pids[racers];
+        for (auto & pid : pids) {
+            pid = spawn([&]() -> int {
+                auto * cq = queue::attach(region, bytes);
+                while ( go.load(std::memory_order_acquire) == 0 ) std::this_thread::yield();
+                try {
+                    auto reader = cq->reader();
+                    won.fetch_add(1);
+                    tried.fetch_add(1);
+                    while ( tried.load() != racers ) std::this_thread::yield(); // hold the role until everyone has tried
+                }
+                catch (std::exception const&) { tried.fetch_add(1); }
+                return 0;
+            });
+        }
+        go.store(1, std::memory_order_release);
+        for (auto pid : pids) assert(exited_ok(pid));
+        assert(won == 1);
+        munmap(counters, 3 * sizeof(std::atomic<u32>));
+        munmap(region, bytes);
+        std::cout << racers << " processes racing for the reader, one won: OK\n";
+    }
+
+    {// attach() checks the layout
+        void * region = map_shared(bytes);
+        assert(throws([&]{ queue::attach(region, bytes); })); // nothing created yet
+        queue::create(region, bytes, capacity);
+        assert(throws([&]{ queue::attach(region, bytes, 2 * capacity); }));
+        assert(throws([&]{ shm_spsc_queue<u64>::attach(region, bytes); }));
+        assert(throws([&]{ queue::attach(region, sizeof(queue)); }));
+        assert(!throws([&]{ queue::attach(region, bytes, capacity); }));
+        munmap(region, bytes);
+        std::cout << "layout checks: OK\n";
+    }
+}
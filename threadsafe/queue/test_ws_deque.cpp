@@ -0,0 +1,103 @@
+//! Work-stealing deque: stress test & throughput benchmark
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <atomic>
+#include "../../thread.hpp"
+#include "../../range.hpp"
+#include "../../timing.hpp"
+
+#include "../ws_deque.hpp"
+
+
+// the owner pushes [0, N) (popping every few pushes), the thieves steal until the owner is done and the deque is drained;
+// every element should be taken exactly once
+void stress(size_t N, size_t n_thieves) {
+    ws_deque<size_t> dq {8}; // small, to make the owner grow the ring under the thieves' feet
+
+    std::vector<std::atomic<unsigned>> taken (N);
+    std::atomic<bool> done {false};
+
+    {// threads
+        std::vector<core::thread> thieves;
+        thieves.reserve(n_thieves);
+        for (size_t _ : core::range(n_thieves)) {
+            (void)_;
+            thieves.emplace_back( [&] {
+                size_t v;
+                while ( !done.load(std::memory_order_acquire) || !dq.empty() ) {
+                    if ( dq.steal(v) ) taken[v].fetch_add(1, std::memory_order_relaxed);
+                    else std::this_thread::yield();
+                }
+            });
+        }
+
+        core::thread owner {[&] {
+            size_t v;
+            for (size_t i : core::range(N)) {
+                dq.push(i);
+                if ( i % 3 == 0 && dq.pop(v) ) taken[v].fetch_add(1, std::memory_order_relaxed);
+            }
+            while ( dq.pop(v) ) taken[v].fetch_add(1, std::memory_order_relaxed);
+            done.store(true, std::memory_order_release);
+        }};
+    }// threads join
+
+    for (size_t i : core::range(N)) {
+        if ( taken[i] != 1 ) {
+            std::cerr << "element " << i << " taken " << taken[i] << " times\n";
+            assert(false);
+        }
+    }
+    std::cout << "stress [" << n_thieves << " thieves]: OK (capacity grew to " << dq.capacity() << ")\n";
+}
+
+
+int main() {
+    using core::timing::ms;
+
+    constexpr size_t N = 1'000'000;
+
+    stress(N, 1);
+    stress(N, 3);
+
+    {// owner-only: push N, pop N
+        ws_deque<size_t> dq {N};
+        size_t sum = 0;
+        auto t = core::timeit([&]{
+            for (size_t i : core::range(N)) dq.push(i);
+            size_t v;
+            while ( dq.pop(v) ) sum += v;
+        });
+        assert(sum == N*(N-1)/2);
+        std::cout << "owner push+pop: " << t.in<ms>() << "ms\n";
+    }
+
+    {// the owner pushes N, n_thieves steal them all
+        constexpr size_t n_thieves = 3;
+        ws_deque<size_t> dq;
+        std::atomic<size_t> global_sum {0};
+        std::atomic<bool> done {false};
+
+        auto t = core::timeit([&]{
+            std::vector<core::thread> thieves;
+            thieves.reserve(n_thieves);
+            for (size_t _ : core::range(n_thieves)) {
+                (void)_;
+                thieves.emplace_back( [&] {
+                    size_t sum = 0, v;
+                    while ( !done.load(std::memory_order_acquire) || !dq.empty() ) {
+                        if ( dq.steal(v) ) sum += v;
+                        else std::this_thread::yield();
+                    }
+                    global_sum += sum;
+                });
+            }
+            for (size_t i : core::range(N)) dq.push(i);
+            done.store(true, std::memory_order_release);
+        });
+        assert(global_sum == N*(N-1)/2);
+        std::cout << "push + " << n_thieves << " thieves: " << t.in<ms>() << "ms\n";
+    }
+}
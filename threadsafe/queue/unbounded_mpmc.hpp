@@ -0,0 +1,274 @@
+// Unbounded lock-free MPMC queue: a linked list of fixed-size ring segments (a-la FAAArrayQueue by P.Ramalhete & A.Correia).
+// Producers and consumers claim slots with a fetch_add on the segment's enqueue / dequeue index instead of a CAS loop,
+// a full segment gets a new one linked after it, a read-through one is unlinked and reclaimed with hazard pointers.
+// Each slot goes empty -> busy -> ready (producer) or empty -> taken (a consumer that got there first, the producer then retries).
+#pragma once
+
+#include <atomic>
+#include <utility> // move, forward
+#include <iostream>
+#include "../../cpu.hpp" // cacheline_size
+#include "../../ints.hpp"
+#include "../../macros.hpp" // NO_UNIQUE_ADDRESS
+#include "../auxiliary/tagged.hpp" // TaggedData
+#include "../auxiliary/backoff.hpp" // cpu_relax
+#include "../auxiliary/event_count.hpp" // event_count, blocking_wait, backoff policies
+#include "../auxiliary/hazard_pointers.hpp"
+#include "../auxiliary/queue_stats.hpp"
+
+
+template <typename Q>
+class unbounded_mpmc_writer {
+public:
+    using value_type = typename Q::value_type;
+
+    unbounded_mpmc_writer(Q & ref) : q{ref}, hp{q.segments.acquire()} { q.n_writers.fetch_add(1); }
+    ~unbounded_mpmc_writer() {
+        q.segments.release(hp);
+        if (q.n_writers.fetch_sub(1) == 1) q.close();
+    }
+
+    unbounded_mpmc_writer(unbounded_mpmc_writer const&) = delete;
+    unbounded_mpmc_writer& operator= (unbounded_mpmc_writer const&) = delete;
+
+    bool try_push(value_type const& data) { q.push(*hp, data); return true; }
+    bool try_push(value_type && data) { q.push(*hp, std::move(data)); return true; }
+    void push(value_type const& data) { q.push(*hp, data); }
+    void push(value_type && data) { q.push(*hp, std::move(data)); }
+
+    template <typename... Args>
+    bool try_emplace(Args&&... args) { q.push(*hp, value_type(std::forward<Args>(args)...)); return true; }
+
+private:
+    Q & q;
+    typename Q::hp_record * hp;
+};
+
+
+template <typename Q>
+class unbounded_mpmc_reader {
+public:
+    using value_type = typename Q::value_type;
+
+    unbounded_mpmc_reader(Q & ref) : q{ref}, hp{q.segments.acquire()} { q.n_readers.fetch_add(1); }
+    ~unbounded_mpmc_reader() {
+        q.segments.release(hp);
+        q.n_readers.fetch_sub(1);
+    }
+
+    unbounded_mpmc_reader(unbounded_mpmc_reader const&) = delete;
+    unbounded_mpmc_reader& operator= (unbounded_mpmc_reader const&) = delete;
+
+    bool try_pop(value_type & data) { return q.try_pop(*hp, data); }
+    bool pop(value_type & data) { return q.pop(*hp, data); }
+
+    explicit operator bool () const { return q.readable(*hp); }
+
+private:
+    Q & q;
+    typename Q::hp_record * hp;
+};
+
+
+/**
+ * @brief unbounded MPMC queue of segment_size-slot segments
+ * @remark pushes never fail or block, the writer/reader descriptors own the hazard pointer records,
+ *         the last writer to go closes the queue
+ */
+template <typename T, size_t segment_size=1024, class Backoff=core::spin_backoff, class Stats=core::no_stats>
+class unbounded_mpmc {
+    enum slot_state : core::u8 { empty, busy, ready, taken };
+
+    struct segment {
+        segment() {
+            for (auto & slot : slots) slot.tag.store(empty, std::memory_order_relaxed);
+        }
+
+        alignas(core::device::CPU::cacheline_size)
+        std::atomic<size_t> enq {0};
+        alignas(core::device::CPU::cacheline_size)
+        std::atomic<size_t> deq {0};
+        alignas(core::device::CPU::cacheline_size)
+        std::atomic<segment*> next {nullptr};
+        core::TaggedData<T, std::atomic<core::u8>> slots[segment_size];
+    };
+
+    using domain_type = core::hazard_domain<segment>;
+    using hp_record = typename domain_type::record;
+
+    friend unbounded_mpmc_writer<unbounded_mpmc>;
+    friend unbounded_mpmc_reader<unbounded_mpmc>;
+
+public:
+    using value_type = T;
+    using backoff_type = Backoff;
+    using stats_type = Stats;
+
+    unbounded_mpmc() {
+        auto * first = new segment;
+        head.store(first, std::memory_order_relaxed);
+        tail.store(first, std::memory_order_relaxed);
+    }
+
+    unbounded_mpmc(unbounded_mpmc const&) = delete;
+    unbounded_mpmc& operator= (unbounded_mpmc const&) = delete;
+
+    ~unbounded_mpmc() {
+        // the retired segments are deleted by the hazard domain
+        auto * seg = head.load(std::memory_order_relaxed);
+        while (seg) {
+            auto * next = seg->next.load(std::memory_order_relaxed);
+            delete seg;
+            seg = next;
+        }
+    }
+
+    unbounded_mpmc_writer<unbounded_mpmc> writer() { return {*this}; }
+    unbounded_mpmc_reader<unbounded_mpmc> reader() { return {*this}; }
+
+
+    void close() {
+        active.store(false, std::memory_order_release);
+        not_empty.notify_all();
+    }
+    bool closed() const { return !active.load(std::memory_order_acquire); }
+
+    // see queue_stats.hpp: counters().snapshot()
+    Stats const& counters() const { return stats; }
+
+
+    void print_state() const {
+        std::cerr << "UQ: head: " << head.load() << " tail: " << tail.load() << " | active: " << std::boolalpha << active.load() << "\n";
+    }
+
+private:
+    template <typename U>
+    void push(hp_record & hp, U && data) {
+        for (;;) {
+            auto * seg = segments.protect(hp, tail);
+            auto idx = seg->enq.fetch_add(1, std::memory_order_acq_rel);
+
+            if ( idx >= segment_size ) { // the segment is full
+                if ( seg != tail.load(std::memory_order_acquire) ) continue;
+                auto * next = seg->next.load(std::memory_order_acquire);
+                if ( next == nullptr ) { // link a new one, whoever gets to link theirs first wins
+                    auto * fresh = new segment;
+                    segment * expected = nullptr;
+                    if ( seg->next.compare_exchange_strong(expected, fresh, std::memory_order_acq_rel) ) {
+                        tail.compare_exchange_strong(seg, fresh, std::memory_order_acq_rel);
+                    }
+                    else {
+                        stats.cas_failed();
+                        delete fresh;
+                    }
+                }
+                else {
+                    tail.compare_exchange_strong(seg, next, std::memory_order_acq_rel);
+                }
+                continue;
+            }
+
+            auto & slot = seg->slots[idx];
+            core::u8 state = empty;
+            if ( slot.tag.compare_exchange_strong(state, busy, std::memory_order_acquire) ) {
+                slot.data = std::forward<U>(data);
+                slot.tag.store(ready, std::memory_order_release);
+                segments.clear(hp);
+                stats.pushed();
+                notify();
+                return;
+            }
+            // a consumer has given up on this slot: take another one
+            stats.cas_failed();
+        }
+    }
+
+    bool try_pop(hp_record & hp, T & data) {
+        for (;;) {
+            auto * seg = segments.protect(hp, head);
+
+            if ( looks_empty(seg) ) {
+                segments.clear(hp);
+                stats.pop_failed();
+                return false;
+            }
+
+            auto idx = seg->deq.fetch_add(1, std::memory_order_acq_rel);
+            if ( idx >= segment_size ) { // read through: move on to the next segment
+                auto * next = seg->next.load(std::memory_order_acquire);
+                if ( next == nullptr ) {
+                    segments.clear(hp);
+                    stats.pop_failed();
+                    return false;
+                }
+                // tail must not be left pointing at a retired segment
+                auto * t = seg;
+                tail.compare_exchange_strong(t, next, std::memory_order_acq_rel);
+                auto * h = seg;
+                if ( head.compare_exchange_strong(h, next, std::memory_order_acq_rel) ) {
+                    segments.clear(hp);
+                    segments.retire(hp, seg);
+                }
+                continue;
+            }
+
+            auto & slot = seg->slots[idx];
+            core::u8 state = empty;
+            if ( slot.tag.compare_exchange_strong(state, taken, std::memory_order_acq_rel) ) {
+                stats.cas_failed(); // the slot is lost to both sides
+                continue; // no producer there yet, it'll retry elsewhere
+            }
+            while ( state == busy ) { // the producer is writing it, won't be long
+                core::cpu_relax();
+                state = slot.tag.load(std::memory_order_acquire);
+            }
+            data = std::move(slot.data);
+            segments.clear(hp);
+            stats.popped();
+            return true;
+        }
+    }
+
+    // blocking pop: false if the queue is closed and drained
+    bool pop(hp_record & hp, T & data) {
+        return core::blocking_wait<Backoff>(not_empty,
+            [&]{ return try_pop(hp, data); },
+            [&]{ return !readable(hp); },
+            stats
+        );
+    }
+
+    bool readable(hp_record & hp) {
+        if ( !closed() ) return true;
+        auto * seg = segments.protect(hp, head);
+        bool empty = looks_empty(seg);
+        segments.clear(hp);
+        return !empty;
+    }
+
+    // all the claimed slots of the (protected) head segment have been consumed and there's no segment after it
+    static bool looks_empty(segment * seg) {
+        auto enq = seg->enq.load(std::memory_order_acquire);
+        if ( enq > segment_size ) enq = segment_size; // producers that overflowed the segment have moved on to the next one
+        return seg->deq.load(std::memory_order_acquire) >= enq
+            && seg->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+    void notify() { if constexpr (Backoff::parks) not_empty.notify_one(); }
+
+    domain_type segments;
+
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<segment*> head {nullptr};
+
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<segment*> tail {nullptr};
+
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<bool> active {true};
+    core::event_count not_empty; // consumers park here
+    std::atomic<unsigned> n_writers {0};
+    std::atomic<unsigned> n_readers {0};
+
+    NO_UNIQUE_ADDRESS Stats stats;
+};
@@ -4,18 +4,39 @@
 #include <cassert>
 #include "../../cpu.hpp" // cacheline_size
 #include "../../range.hpp" 
+#include "../../macros.hpp" // NO_UNIQUE_ADDRESS
 #include "spsc_queue.hpp" // used as a channel to transfer free_blocks 
 #include "../auxiliary/tagged.hpp" // TaggedData 
+#include "../auxiliary/slot_ref.hpp" // slot_ref 
+#include "../auxiliary/event_count.hpp" // event_count, blocking_wait, backoff policies
+#include "../auxiliary/queue_stats.hpp"
 #include "io_descriptors.hpp" // core::{queue_reader, queue_writer}
 
 #include <vector>
+#include <memory> // allocator_traits
 
 
 
-template <typename T, size_t chunk_size=256, typename size_type=unsigned>
+/**
+ * @brief unbounded SPSC queue: a list of chunk_size-element blocks, read-through blocks are sent back to the producer for reuse
+ * @remark Allocator (rebound to the block type) is used by the producer to allocate and by the consumer to free blocks, 
+ *         so it should be usable from both threads (a thread-safe pool / std::allocator)
+ */
+template <typename T, size_t chunk_size=256, typename size_type=unsigned, class Backoff=core::spin_backoff, class Allocator=std::allocator<T>, class Stats=core::no_stats>
 class unbounded_spsc_queue {
 public:
     using value_type = T;
+    using backoff_type = Backoff;
+    using allocator_type = Allocator;
+    using stats_type = Stats;
+
+    // block usage, for sizing the pool
+    struct block_stats {
+        size_t allocated; // blocks taken from the allocator (including the reserved ones)
+        size_t recycled;  // blocks the producer got back from the consumer instead of allocating
+        size_t released;  // blocks given back to the allocator because the recycling list was at its high-water mark
+        size_t peak;      // max. blocks alive at a time
+    };
 
     static constexpr core::u8 max_writers = 1;
     static constexpr core::u8 max_readers = 1;
@@ -38,9 +59,23 @@ private:
         std::atomic<Block*> next {nullptr};
     };
 
+    using block_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Block>;
+    using block_traits = std::allocator_traits<block_allocator>;
+
 public:
 
-    unbounded_spsc_queue(unsigned n_free_blocks=8) : free_blocks{n_free_blocks} {
+    /**
+     * @param high_water_mark max. free blocks kept for reuse (rounded up to a power of two), the rest go back to the allocator
+     * @param reserved blocks allocated up front (at most high_water_mark), so that a burst doesn't hit the allocator
+     */
+    unbounded_spsc_queue(unsigned high_water_mark=8, unsigned reserved=0, Allocator const& allocator=Allocator{}) 
+    : alloc{allocator}, free_blocks{high_water_mark} {
+        read_block = write_block = allocate();
+        for (size_t _ : core::range(reserved)) {
+            (void)_;
+            auto * block = allocate();
+            if (!free_blocks.try_push(block)) { deallocate(block); break; }
+        }
         #if LOG
         std::cerr << "[read: " << read_block << "]\n";
         #endif
@@ -52,12 +87,16 @@ public:
             #if LOG
             std::cerr << "[~ "<<mem<<"]\n";
             #endif
-            delete mem;
+            deallocate(mem);
+        }
+        while (read_block) { // the blocks that haven't been read through
+            auto * next = read_block->next.load(std::memory_order_relaxed);
+            #if LOG
+            std::cerr << "[~ "<<read_block<<"]\n";
+            #endif
+            deallocate(read_block);
+            read_block = next;
         }
-        #if LOG
-        std::cerr << "[~ "<<read_block<<"]\n";
-        #endif
-        delete read_block;
     }
 
     core::queue_reader<unbounded_spsc_queue> reader() {
@@ -74,14 +113,10 @@ public:
     bool try_pop(T & data) {
         if (read_idx >= chunk_size) { // current block has been read through
             auto * next = read_block->next.load(std::memory_order_acquire);
-            if (!next) return false;
+            if (!next) { _stats.pop_failed(); return false; }
             
             // advance to the next block
-            read_block->next.store(nullptr, std::memory_order_relaxed);//release);
-            if (!free_blocks.try_push(read_block)) {
-                // reuse space is full, delete the block:
-                delete read_block; 
-            }
+            recycle(read_block);
             read_block = next;
             read_idx = 0;
         }
@@ -94,8 +129,10 @@ public:
             data = std::move(cell.data);
             cell.tag.store(false, std::memory_order_release);
             read_idx += 1;
+            _stats.popped();
             return true;
         }
+        _stats.pop_failed();
         return false;
     }
 
@@ -104,16 +141,11 @@ public:
         if (write_idx >= chunk_size) {
             // assert(write_block->next.load(std::memory_order_acquire) == nullptr);
             
-            Block * reused;
-            if (!free_blocks.try_pop(reused)) {
-                reused = new Block; 
-                #if LOG
-                std::cerr << "[new "<<reused<<"]\n";
-                #endif
-            }
-            write_block->next.store(reused, std::memory_order_release);
-            write_block = reused;
+            auto * next = next_block();
+            write_block->next.store(next, std::memory_order_release);
+            write_block = next;
             write_idx = 0;
+            _stats.push_failed();
             return false;
         }
         assert(write_block != nullptr);
@@ -121,6 +153,8 @@ public:
         cell.data = data;
         cell.tag.store(true, std::memory_order_release);
         write_idx += 1;
+        _stats.pushed();
+        notify(not_empty);
         return true;
     }
 
@@ -129,12 +163,9 @@ public:
         if (write_idx >= chunk_size) {
             // assert(write_block->next.load(std::memory_order_acquire) == nullptr);
             
-            Block * reused;
-            if (!free_blocks.try_pop(reused)) {
-                reused = new Block; 
-            }
-            write_block->next.store(reused, std::memory_order_relaxed);//release);
-            write_block = reused;
+            auto * next = next_block();
+            write_block->next.store(next, std::memory_order_release); // the consumer frees / reuses the old block once it sees this
+            write_block = next;
             write_idx = 0;
         }
 
@@ -144,34 +175,167 @@ public:
         cell.data = data;
         cell.tag.store(true, std::memory_order_release); // write_block->next will be synced
         write_idx += 1;
+        _stats.pushed();
+        notify(not_empty);
+    }
+
+    // blocking pop: false if the queue is closed and drained
+    bool pop(T & data) {
+        return core::blocking_wait<Backoff>(not_empty, 
+            [&]{ return try_pop(data); }, 
+            [&]{ return !bool(*this); },
+            _stats
+        );
     }
     
 
-    void close() { active.store(false, std::memory_order_release); }
+    /**
+     * @brief zero-copy push: returns the next writable cell, never empty (the queue grows as needed),
+     *        the cell is published by commit()
+     */
+    core::slot_ref<T, size_type> reserve() {
+        if (write_idx >= chunk_size) {
+            auto * next = next_block();
+            write_block->next.store(next, std::memory_order_release);
+            write_block = next;
+            write_idx = 0;
+        }
+        return {&write_block->cells[write_idx].data, write_idx};
+    }
+
+    void commit(core::slot_ref<T, size_type> const& slot) {
+        write_block->cells[slot.index].tag.store(true, std::memory_order_release); // write_block->next will be synced
+        write_idx += 1;
+        _stats.pushed();
+        notify(not_empty);
+    }
+
+    /**
+     * @brief zero-copy pop: returns the front cell to be read in-place (empty if there's none),
+     *        the cell is handed back by release()
+     */
+    core::slot_ref<T, size_type> peek() {
+        if (read_idx >= chunk_size) { // current block has been read through
+            auto * next = read_block->next.load(std::memory_order_acquire);
+            if (!next) { _stats.pop_failed(); return {}; }
+            
+            // advance to the next block
+            recycle(read_block);
+            read_block = next;
+            read_idx = 0;
+        }
+
+        auto& cell = read_block->cells[read_idx];
+        if ( cell.tag.load(std::memory_order_acquire) ) {
+            return {&cell.data, read_idx};
+        }
+        _stats.pop_failed();
+        return {};
+    }
+
+    void release(core::slot_ref<T, size_type> const& slot) {
+        read_block->cells[slot.index].tag.store(false, std::memory_order_release);
+        read_idx += 1;
+        _stats.popped();
+    }
+
+    void close() { 
+        active.store(false, std::memory_order_release); 
+        not_empty.notify_all();
+    }
     bool closed() const { return !active.load(std::memory_order_acquire); }
     
-    bool empty() const { return (read_block->cells[read_idx].tag.load(std::memory_order_acquire) == false); }
+    bool empty() const { 
+        if (read_idx >= chunk_size) { // read through the current block, look at the next one
+            auto * next = read_block->next.load(std::memory_order_acquire);
+            return !next || (next->cells[0].tag.load(std::memory_order_acquire) == false);
+        }
+        return (read_block->cells[read_idx].tag.load(std::memory_order_acquire) == false); 
+    }
 
     explicit operator bool () const {
         return !(closed() && empty());
     }
 
+    // a snapshot, safe to take from any thread
+    block_stats stats() const {
+        return {
+            n_allocated.load(std::memory_order_relaxed),
+            n_recycled.load(std::memory_order_relaxed),
+            n_released.load(std::memory_order_relaxed),
+            n_peak.load(std::memory_order_relaxed)
+        };
+    }
+
+    // push / pop counters, see queue_stats.hpp: counters().snapshot()
+    Stats const& counters() const { return _stats; }
+
 private:
-    spsc_queue< Block* > free_blocks; // free blocks (for reuse)
+    void notify(core::event_count & ec) { if constexpr (Backoff::parks) ec.notify_one(); }
+
+    // [producer] a free block from the consumer if there's one, a new one otherwise
+    Block * next_block() {
+        Block * block;
+        if ( free_blocks.try_pop(block) ) {
+            n_recycled.store(n_recycled.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return block;
+        }
+        block = allocate();
+        #if LOG
+        std::cerr << "[new "<<block<<"]\n";
+        #endif
+        return block;
+    }
+
+    // [consumer] hands a read-through block back to the producer, frees it if the recycling list is at its high-water mark
+    void recycle(Block * block) {
+        block->next.store(nullptr, std::memory_order_relaxed);
+        if ( !free_blocks.try_push(block) ) {
+            deallocate(block);
+            n_released.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // [producer]
+    Block * allocate() {
+        auto * block = block_traits::allocate(alloc, 1);
+        block_traits::construct(alloc, block);
+        auto allocated = n_allocated.load(std::memory_order_relaxed) + 1;
+        n_allocated.store(allocated, std::memory_order_relaxed);
+        auto alive = allocated - n_released.load(std::memory_order_relaxed);
+        if ( alive > n_peak.load(std::memory_order_relaxed) ) n_peak.store(alive, std::memory_order_relaxed);
+        return block;
+    }
+
+    // [consumer]
+    void deallocate(Block * block) {
+        block_traits::destroy(alloc, block);
+        block_traits::deallocate(alloc, block, 1);
+    }
+
+    block_allocator alloc;
+
+    spsc_queue< Block*, unsigned, core::spin_backoff > free_blocks; // free blocks (for reuse), never waited on
 
     // reader thread:
     alignas(core::device::CPU::cacheline_size) 
-    Block * read_block = new Block{};
+    Block * read_block {nullptr};
     size_type read_idx {0};
     unsigned n_readers {0};
+    std::atomic<size_t> n_released {0};
     
     // writer thread:
     alignas(core::device::CPU::cacheline_size) 
-    Block * write_block = read_block;
+    Block * write_block {nullptr};
     size_type write_idx {0};
     unsigned n_writers {0};
+    std::atomic<size_t> n_allocated {0};
+    std::atomic<size_t> n_recycled {0};
+    std::atomic<size_t> n_peak {0};
 
     alignas(core::device::CPU::cacheline_size) 
     std::atomic<bool> active {true};
-    
+    core::event_count not_empty; // the consumer parks here
+
+    NO_UNIQUE_ADDRESS Stats _stats;
 };
\ No newline at end of file
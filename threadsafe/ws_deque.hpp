@@ -0,0 +1,166 @@
+// Chase-Lev work-stealing deque, with the memory orders from
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (N.M. Le, A.Pop, A.Cohen, F.Zappa Nardelli, PPoPP'13)
+// The owner thread pushes and pops at the bottom (LIFO), any number of thieves steal from the top (FIFO).
+// The ring grows when the owner pushes into a full one: old rings stay alive until the deque is destroyed,
+// since a thief might still be reading from one of them.
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <type_traits>
+#include <stdexcept> // length_error
+#include <iostream>
+#include "../cpu.hpp" // cacheline_size
+#include "../bits.hpp" // ceil_pow2
+#include "../ints.hpp"
+
+
+template <typename T>
+class ws_deque {
+    // thieves may read a slot while the owner overwrites it (the steal then fails on the CAS), so slots are atomic<T>
+    static_assert(std::is_trivially_copyable<T>::value, "ws_deque<T> requires a trivially copyable T (store pointers / handles to tasks)");
+
+    using index_type = core::i64;
+
+    struct ring {
+        ring(index_type size) : size{size}, mask{size - 1}, slots{new std::atomic<T>[size_t(size)]} {}
+
+        T get(index_type i) const noexcept { return slots[i & mask].load(std::memory_order_relaxed); }
+        void put(index_type i, T const& v) noexcept { slots[i & mask].store(v, std::memory_order_relaxed); }
+
+        // a twice as big copy of [top, bottom)
+        ring * grow(index_type top, index_type bottom) const {
+            auto * bigger = new ring(2 * size);
+            for (index_type i = top; i != bottom; ++i) bigger->put(i, get(i));
+            return bigger;
+        }
+
+        const index_type size; // always a power of two
+        const index_type mask;
+        std::unique_ptr<std::atomic<T>[]> slots;
+    };
+
+public:
+    using value_type = T;
+
+    ws_deque(size_t capacity=1024) {
+        if (core::ceil_pow2(capacity) == 0) throw std::length_error("ws_deque: capacity too large");
+        auto * initial = new ring(index_type(core::ceil_pow2(capacity < 2 ? 2 : capacity)));
+        rings.emplace_back(initial);
+        active_ring.store(initial, std::memory_order_relaxed);
+    }
+
+    ws_deque(ws_deque const&) = delete;
+    ws_deque& operator= (ws_deque const&) = delete;
+
+
+    /**
+     * @brief [owner] pushes to the bottom, grows the ring if it's full
+     */
+    void push(T const& value) {
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_acquire);
+        auto * a = active_ring.load(std::memory_order_relaxed);
+
+        if ( b - t > a->size - 1 ) { // full
+            a = a->grow(t, b);
+            rings.emplace_back(a);
+            active_ring.store(a, std::memory_order_release);
+        }
+        put(a, b, value);
+    }
+
+    /**
+     * @brief [owner] pushes to the bottom, false if the ring is full (never grows)
+     */
+    bool try_push(T const& value) {
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_acquire);
+        auto * a = active_ring.load(std::memory_order_relaxed);
+
+        if ( b - t > a->size - 1 ) return false;
+        put(a, b, value);
+        return true;
+    }
+
+    /**
+     * @brief [owner] pops the most recently pushed element
+     * @return false if the deque is empty (or the last element has just been stolen)
+     */
+    bool pop(T & value) {
+        auto b = bottom.load(std::memory_order_relaxed) - 1;
+        auto * a = active_ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the fence in steal()
+        auto t = top.load(std::memory_order_relaxed);
+
+        if ( t > b ) { // empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        value = a->get(b);
+        if ( t == b ) { // the last one: race the thieves for it
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /**
+     * @brief [any thread] steals the least recently pushed element
+     * @return false if the deque is empty or another thief / the owner won the race for the element
+     */
+    bool steal(T & value) {
+        auto t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the fence in pop()
+        auto b = bottom.load(std::memory_order_acquire);
+
+        if ( t >= b ) return false; // empty
+
+        auto * a = active_ring.load(std::memory_order_acquire);
+        auto v = a->get(t);
+        if ( !top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed) ) {
+            return false; // lost the race
+        }
+        value = v;
+        return true;
+    }
+
+
+    // approximate unless called by the owner with no thieves around
+    size_t size() const {
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_relaxed);
+        return b > t ? size_t(b - t) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const { return size_t(active_ring.load(std::memory_order_relaxed)->size); }
+
+
+    void print_state() const {
+        std::cerr << "WSD: [" << top.load() << " -> " << bottom.load() << "] | capacity: " << capacity() << " | rings: " << rings.size() << "\n";
+    }
+
+private:
+    void put(ring * a, index_type b, T const& value) {
+        a->put(b, value);
+        // the paper's release fence + relaxed store, as a release store: same ordering for the thieves' acquire of `bottom`,
+        // and visible to ThreadSanitizer, which doesn't model fences (T may be a pointer to data the thief reads next)
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // thieves:
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<index_type> top {0};
+
+    // owner:
+    alignas(core::device::CPU::cacheline_size)
+    std::atomic<index_type> bottom {0};
+    std::atomic<ring*> active_ring {nullptr};
+    std::vector<std::unique_ptr<ring>> rings; // every ring ever used, freed with the deque
+};